@@ -0,0 +1,265 @@
+/*
+    事件中心
+    把StatusMachine.cpp注释里设想的架构真正做出来：
+
+    线程1..N（生产者）：
+        当事件发生时，被发送到某个center，集中处理
+    线程2（消费者）：
+        不断从center中取出事件，用状态机进行处理
+        处理时，使用状态机检查事件是否正确
+        不正确，则消费失败 —— 对于不正确的事件，不一定要消费失败，还可以超时
+        所以当不匹配的事件发生时，会有两种结果：
+            一种是直接失败（FailImmediately）
+            另一种是继续等待，超时才算失败（RequeueWithTimeout）
+
+    center本身是一个有界无锁MPSC环形队列：
+        多生产者入队（CAS抢位置），单消费者出队（不需要同步）
+        队列满时postEvent()让生产者等待 —— 这就是背压，
+        p99延迟不会因为队列无限膨胀而失控
+*/
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//有界无锁MPSC环形队列
+//每个槽位带一个sequence号（Vyukov队列的思路）：
+//  seq == pos        槽位空，可写
+//  seq == pos + 1    槽位满，可读
+//生产者CAS抢tail，消费者只有一个，head不需要CAS
+class MpscEventRing{
+private:
+    struct Cell{
+        std::atomic<std::size_t> seq;
+        Event event;
+    };
+
+    std::vector<Cell> cells_;
+    std::size_t mask_;
+    std::atomic<std::size_t> tail_{0};   //生产者端
+    std::atomic<std::size_t> head_{0};   //消费者端
+
+public:
+    //容量必须是2的幂
+    explicit MpscEventRing(std::size_t capacity)
+        : cells_(capacity), mask_(capacity - 1)
+    {
+        for (std::size_t i = 0; i < capacity; ++i){
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //多生产者入队，队列满返回false
+    bool tryPush(Event event){
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;){
+            Cell &cell = cells_[pos & mask_];
+            std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            if (seq == pos){
+                //槽位空闲，CAS抢这个位置
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)){
+                    cell.event = event;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+                //CAS失败，pos已被更新成最新tail，重试
+            }else if (seq < pos){
+                //槽位还没被消费者释放 —— 队列满
+                return false;
+            }else{
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //单消费者出队，队列空返回false
+    bool tryPop(Event &event){
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        Cell &cell = cells_[pos & mask_];
+        std::size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (seq != pos + 1) return false;   //还没有可读的事件
+        event = cell.event;
+        //释放槽位：下一圈的生产者才能用
+        cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+        head_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+//不匹配事件的处理策略
+enum class MismatchPolicy{
+    FailImmediately,     //直接消费失败
+    RequeueWithTimeout   //先放回等待，状态变了再重试，超时才失败
+};
+
+//事件中心：MPSC队列 + 专门的消费者线程驱动状态机
+class EventCenter{
+private:
+    MpscEventRing ring_;
+    LockFreeStateMachine &machine_;
+    MismatchPolicy policy_;
+    std::chrono::milliseconds timeout_;
+
+    std::thread consumer_;
+    std::atomic<bool> running_{false};
+
+    //等待重试的事件（只有消费者线程访问，不需要锁）
+    struct PendingEvent{
+        Event event;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::deque<PendingEvent> pending_;
+
+    //统计
+    std::atomic<std::size_t> processed_{0};
+    std::atomic<std::size_t> failed_{0};
+    std::atomic<std::size_t> requeued_{0};
+
+public:
+    EventCenter(LockFreeStateMachine &machine,
+                MismatchPolicy policy,
+                std::chrono::milliseconds timeout = std::chrono::milliseconds(50),
+                std::size_t capacity = 1024)
+        : ring_(capacity), machine_(machine), policy_(policy), timeout_(timeout)
+    {}
+
+    ~EventCenter(){ stop(); }
+
+    void start(){
+        running_.store(true);
+        consumer_ = std::thread([this]{ consumeLoop(); });
+    }
+
+    //停止：先把队列里剩下的事件消费完再退出
+    void stop(){
+        if (!running_.exchange(false)) return;
+        if (consumer_.joinable()) consumer_.join();
+    }
+
+    //生产者接口
+    //队列满时原地等待（背压），不会无限堆积
+    void postEvent(Event event){
+        while (!ring_.tryPush(event)){
+            std::this_thread::yield();
+        }
+    }
+
+    //非阻塞版本：队列满直接返回false，由调用方决定丢弃还是重试
+    bool tryPostEvent(Event event){
+        return ring_.tryPush(event);
+    }
+
+    std::size_t processedCount() const { return processed_.load(); }
+    std::size_t failedCount() const { return failed_.load(); }
+    std::size_t requeuedCount() const { return requeued_.load(); }
+
+private:
+    void consumeLoop(){
+        Event event;
+        while (running_.load() || pending_.size() > 0 || peekHasEvent()){
+            bool advanced = false;
+            if (ring_.tryPop(event)){
+                advanced = consumeOne(event);
+            }else{
+                std::this_thread::yield();
+            }
+            //状态推进过，等待中的事件可能匹配了，重试一轮
+            if (advanced){
+                retryPending();
+            }
+            expirePending();
+        }
+    }
+
+    bool peekHasEvent(){
+        //退出前把队列清空：再试一次pop
+        Event event;
+        if (!ring_.tryPop(event)) return false;
+        if (consumeOne(event)) retryPending();
+        return true;
+    }
+
+    //消费一个事件，返回状态是否推进
+    bool consumeOne(Event event){
+        if (machine_.handleEvent(event)){
+            processed_.fetch_add(1);
+            return true;
+        }
+        //事件和当前状态不匹配
+        if (policy_ == MismatchPolicy::FailImmediately){
+            failed_.fetch_add(1);
+        }else{
+            requeued_.fetch_add(1);
+            pending_.push_back({event,
+                std::chrono::steady_clock::now() + timeout_});
+        }
+        return false;
+    }
+
+    //状态变化后重试等待中的事件，能成功几个算几个
+    void retryPending(){
+        bool progress = true;
+        while (progress){
+            progress = false;
+            for (auto it = pending_.begin(); it != pending_.end(); ){
+                if (machine_.handleEvent(it->event)){
+                    processed_.fetch_add(1);
+                    it = pending_.erase(it);
+                    progress = true;
+                }else{
+                    ++it;
+                }
+            }
+        }
+    }
+
+    //超时的等待事件按失败处理
+    void expirePending(){
+        auto now = std::chrono::steady_clock::now();
+        while (!pending_.empty() && pending_.front().deadline <= now){
+            failed_.fetch_add(1);
+            pending_.pop_front();
+        }
+    }
+};
+
+int main()
+{
+    LockFreeStateMachine machine;
+
+    //超时重排策略：Resume先于Pause到达也不会丢，等状态跟上
+    EventCenter center(machine, MismatchPolicy::RequeueWithTimeout,
+                       std::chrono::milliseconds(100));
+    center.start();
+
+    //多个生产者往center发事件，消费者线程集中处理
+    std::vector<std::thread> producers;
+    producers.emplace_back([&]{ center.postEvent(Event::Start); });
+    producers.emplace_back([&]{
+        //故意先发Resume再发Pause，考验重排队
+        center.postEvent(Event::Resume);
+        center.postEvent(Event::Pause);
+    });
+    producers.emplace_back([&]{ center.postEvent(Event::Stop); });
+
+    for (auto &t : producers) t.join();
+
+    //给消费者一点时间处理完
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    center.stop();
+
+    cout << "processed: " << center.processedCount()
+         << ", requeued: " << center.requeuedCount()
+         << ", failed: " << center.failedCount() << endl;
+    cout << "Final State: "
+         << strState[static_cast<int>(machine.getCurrentState())] << endl;
+    return 0;
+}
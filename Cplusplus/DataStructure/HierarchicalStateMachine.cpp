@@ -0,0 +1,175 @@
+/*
+    层次状态机（复合状态）
+
+    设备模型需要子状态，比如：
+        Running.{Warming, Steady, Draining}
+    以前用几个SyncStateMachine拼起来，外面再包一层胶水代码，
+    一个事件要拿好几把锁
+
+    这里的做法：
+        复合状态（父状态 + 子状态）打包进一个字节，放进一个atomic
+        父状态的转换规则在编译期展开（“压平”）到每一个子状态上，
+        和子状态自己的规则合成一张扁平表
+        于是不管嵌套多深，处理一个事件就是一次查表 + 一次CAS
+
+    规则：
+        父状态规则对该父状态的所有子状态生效（如Running.*收到Stop都进Stopped）
+        进入有子状态的父状态时落在初始子状态（Running的初始子状态是Warming）
+        子状态规则只在对应父状态内生效
+*/
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+
+//子状态枚举（None表示该父状态没有子状态）
+enum class SubState : uint8_t{
+    None,
+    Warming,
+    Steady,
+    Draining
+};
+
+constexpr size_t kSubStateCount = 4;
+
+inline std::vector<std::string> strSubState = {"", ".Warming", ".Steady", ".Draining"};
+
+//层次机的事件：父状态事件 + 子状态事件
+enum class HEvent : uint8_t{
+    Start,      //父
+    Pause,
+    Resume,
+    Stop,
+    WarmedUp,   //子：Warming -> Steady
+    Drain       //子：Steady -> Draining
+};
+
+constexpr size_t kHEventCount = 6;
+
+//复合状态打包：一个字节装下（父状态*子状态数 + 子状态）
+constexpr uint8_t pack(State s, SubState sub)
+{
+    return static_cast<uint8_t>(
+        static_cast<size_t>(s) * kSubStateCount + static_cast<size_t>(sub));
+}
+constexpr State parentOf(uint8_t c){ return static_cast<State>(c / kSubStateCount); }
+constexpr SubState subOf(uint8_t c){ return static_cast<SubState>(c % kSubStateCount); }
+
+constexpr size_t kCompositeCount = kStateCount * kSubStateCount;
+
+//进入某个父状态时落在哪个子状态
+constexpr SubState initialSub(State s)
+{
+    return s == State::Running ? SubState::Warming : SubState::None;
+}
+
+//压平后的转换表：[复合状态][事件] -> 复合状态
+class FlatHierTable{
+private:
+    int8_t next_[kCompositeCount][kHEventCount];
+
+public:
+    static constexpr int8_t kInvalid = -1;
+
+    constexpr FlatHierTable(): next_{}
+    {
+        for (auto &row : next_)
+            for (auto &cell : row) cell = kInvalid;
+
+        //1. 把父状态规则（transitionRules）展开到每个子状态上
+        //   父事件和HEvent的前四个取值一致
+        for (size_t s = 0; s < kStateCount; ++s){
+            for (size_t e = 0; e < kEventCount; ++e){
+                State to;
+                if (!transitionRules.find(static_cast<State>(s),
+                                          static_cast<Event>(e), to)){
+                    continue;
+                }
+                uint8_t target = pack(to, initialSub(to));
+                for (size_t sub = 0; sub < kSubStateCount; ++sub){
+                    next_[pack(static_cast<State>(s),
+                               static_cast<SubState>(sub))][e] =
+                        static_cast<int8_t>(target);
+                }
+            }
+        }
+
+        //2. 子状态自己的规则（只在Running内部）
+        add(State::Running, SubState::Warming, HEvent::WarmedUp,
+            State::Running, SubState::Steady);
+        add(State::Running, SubState::Steady, HEvent::Drain,
+            State::Running, SubState::Draining);
+    }
+
+    constexpr void add(State fromS, SubState fromSub, HEvent event,
+                       State toS, SubState toSub)
+    {
+        next_[pack(fromS, fromSub)][static_cast<size_t>(event)] =
+            static_cast<int8_t>(pack(toS, toSub));
+    }
+
+    constexpr bool find(uint8_t from, HEvent event, uint8_t &to) const
+    {
+        int8_t n = next_[from][static_cast<size_t>(event)];
+        if (n == kInvalid) return false;
+        to = static_cast<uint8_t>(n);
+        return true;
+    }
+};
+
+inline constexpr FlatHierTable hierRules{};
+
+//层次状态机：复合状态就是一个原子字节
+//一个事件 = 一次查表 + 一次CAS，嵌套状态也不例外
+class HierStateMachine{
+private:
+    std::atomic<uint8_t> composite_;
+
+public:
+    HierStateMachine(): composite_(pack(State::Idle, SubState::None)){}
+
+    bool handleEvent(HEvent event)
+    {
+        uint8_t expected = composite_.load();
+        uint8_t desired;
+        do{
+            if (!hierRules.find(expected, event, desired)) return false;
+        }while(!composite_.compare_exchange_weak(expected, desired));
+        return true;
+    }
+
+    State parentState() const { return parentOf(composite_.load()); }
+    SubState subState() const { return subOf(composite_.load()); }
+
+    std::string name() const
+    {
+        uint8_t c = composite_.load();
+        return strState[static_cast<int>(parentOf(c))] +
+               strSubState[static_cast<int>(subOf(c))];
+    }
+};
+
+int main()
+{
+    HierStateMachine machine;
+    cout << "init: " << machine.name() << endl;
+
+    auto feed = [&](HEvent e, const char *label){
+        bool ok = machine.handleEvent(e);
+        cout << label << " -> " << machine.name()
+             << (ok ? "" : " (rejected)") << endl;
+    };
+
+    feed(HEvent::Start, "Start");        //Idle -> Running.Warming
+    feed(HEvent::Drain, "Drain");        //Warming阶段不能Drain，拒绝
+    feed(HEvent::WarmedUp, "WarmedUp");  //Running.Warming -> Running.Steady
+    feed(HEvent::Pause, "Pause");        //父规则对所有子状态生效 -> Paused
+    feed(HEvent::Resume, "Resume");      //回到Running时重新从Warming开始
+    feed(HEvent::WarmedUp, "WarmedUp");
+    feed(HEvent::Drain, "Drain");        //Running.Steady -> Running.Draining
+    feed(HEvent::Stop, "Stop");          //任何Running.* -> Stopped
+    return 0;
+}
@@ -0,0 +1,247 @@
+/*
+    海量实例的状态机管理器
+
+    每个连接一个会话状态，规模到百万级时：
+        SyncStateMachine每个实例背一个std::mutex（40+字节），太重
+        就算用LockFreeStateMachine，每实例也要一个对象
+
+    这里用LockFreeStateMachine的思路做成键值表：
+        64位key -> 1字节原子状态
+        开放寻址（线性探测），key数组和状态数组分开存，
+        每个会话大约9字节（8字节key + 1字节状态）
+        按key哈希分成N个shard，不同shard之间完全无共享，
+        吞吐随核数线性扩展
+
+    状态字节单独成一个紧凑数组，这也给批量推进（恢复/回放路径）
+    留了一个可以整块扫描的布局：
+        状态数组存的是普通字节，单事件路径用std::atomic_ref按原子访问，
+        批量路径（broadcastEvent）把整个数组当字节块线性处理，
+        x86上16个状态一条pshufb完成查表
+*/
+
+#pragma once
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+class StateMachineShardMap{
+private:
+    //单个shard：固定容量的开放寻址表
+    //key为0表示空槽（所以0不能当会话key用）
+    class Shard{
+    private:
+        std::vector<std::atomic<std::uint64_t>> keys_;
+        std::vector<std::uint8_t> states_;   //原子访问经由atomic_ref
+        std::size_t mask_;
+        std::atomic<std::size_t> used_{0};
+
+    public:
+        explicit Shard(std::size_t capacity)
+            : keys_(capacity), states_(capacity), mask_(capacity - 1)
+        {
+            for (std::size_t i = 0; i < capacity; ++i){
+                keys_[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        //找到key所在槽位，不存在就抢一个空槽插入（初始状态Idle）
+        //返回槽位下标，表满返回capacity
+        std::size_t findOrInsert(std::uint64_t key, std::size_t hash){
+            for (std::size_t probe = 0; probe <= mask_; ++probe){
+                std::size_t i = (hash + probe) & mask_;
+                std::uint64_t k = keys_[i].load(std::memory_order_acquire);
+                if (k == key) return i;
+                if (k == 0){
+                    //空槽，CAS抢占
+                    //状态字节不用预写Idle：数组零初始化（Idle==0）且槽位
+                    //从不回收，新抢到的槽一定已经是Idle；在抢key之前写
+                    //反而有竞态——别的线程可能已经抢走这个槽并推进了状态，
+                    //这里再写Idle就把人家的会话重置了
+                    std::uint64_t expected = 0;
+                    if (keys_[i].compare_exchange_strong(expected, key,
+                                                         std::memory_order_release)){
+                        used_.fetch_add(1, std::memory_order_relaxed);
+                        return i;
+                    }
+                    //被别人抢了，看看是不是同一个key
+                    if (expected == key) return i;
+                }
+            }
+            return keys_.size();   //表满
+        }
+
+        //只查不插
+        std::size_t find(std::uint64_t key, std::size_t hash) const {
+            for (std::size_t probe = 0; probe <= mask_; ++probe){
+                std::size_t i = (hash + probe) & mask_;
+                std::uint64_t k = keys_[i].load(std::memory_order_acquire);
+                if (k == key) return i;
+                if (k == 0) break;
+            }
+            return keys_.size();
+        }
+
+        //对槽位上的状态字节做一次事件转换（CAS循环）
+        bool handleEventAt(std::size_t i, Event event){
+            std::atomic_ref<std::uint8_t> st(states_[i]);
+            std::uint8_t expected = st.load();
+            State desired;
+            do{
+                if (!transitionRules.find(static_cast<State>(expected), event, desired)){
+                    return false;
+                }
+            }while(!st.compare_exchange_weak(
+                        expected, static_cast<std::uint8_t>(desired)));
+            return true;
+        }
+
+        State stateAt(std::size_t i) const {
+            return static_cast<State>(
+                std::atomic_ref<const std::uint8_t>(states_[i]).load());
+        }
+
+        std::size_t capacity() const { return keys_.size(); }
+        std::size_t size() const { return used_.load(); }
+
+        //批量遍历本shard所有会话
+        template <typename Fn>
+        void forEach(Fn &&fn) const {
+            for (std::size_t i = 0; i < keys_.size(); ++i){
+                std::uint64_t k = keys_[i].load(std::memory_order_acquire);
+                if (k != 0){
+                    fn(k, stateAt(i));
+                }
+            }
+        }
+
+        //批量推进：对整个状态数组套一张16字节的映射表
+        //只用于恢复/回放这类静止场景，期间不能有并发的单事件CAS
+        void bulkApply(const std::uint8_t (&lut)[16]){
+            std::size_t n = states_.size();
+            std::size_t i = 0;
+#if defined(__SSSE3__)
+            //状态值恒小于16，一条pshufb就是16次并行查表
+            __m128i table = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(lut));
+            for (; i + 16 <= n; i += 16){
+                __m128i v = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(&states_[i]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(&states_[i]),
+                                 _mm_shuffle_epi8(table, v));
+            }
+#endif
+            for (; i < n; ++i){
+                states_[i] = lut[states_[i] & 0x0f];
+            }
+            //空槽的字节也被映射过了，复位回Idle：
+            //findOrInsert依赖“抢到的槽一定已经是Idle”这个不变量
+            //进门时空槽字节必为Idle（归纳成立），所以只有事件真的把
+            //Idle映射走了（比如广播Start）才需要这一遍修复
+            if (lut[static_cast<std::size_t>(State::Idle)] !=
+                static_cast<std::uint8_t>(State::Idle)){
+                for (std::size_t j = 0; j < n; ++j){
+                    if (keys_[j].load(std::memory_order_relaxed) == 0){
+                        states_[j] = static_cast<std::uint8_t>(State::Idle);
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::size_t shardMask_;
+
+    //64位混合哈希（splitmix64的finalizer），
+    //低位选槽，先用整个哈希的高位选shard
+    static std::uint64_t mix(std::uint64_t x){
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    Shard &shardFor(std::uint64_t hash){
+        return *shards_[(hash >> 48) & shardMask_];
+    }
+    const Shard &shardFor(std::uint64_t hash) const {
+        return *shards_[(hash >> 48) & shardMask_];
+    }
+
+public:
+    //capacityPerShard和shardCount都必须是2的幂
+    //shard数一般取核数附近
+    explicit StateMachineShardMap(std::size_t capacityPerShard,
+                                  std::size_t shardCount = 16)
+        : shardMask_(shardCount - 1)
+    {
+        shards_.reserve(shardCount);
+        for (std::size_t i = 0; i < shardCount; ++i){
+            shards_.push_back(std::make_unique<Shard>(capacityPerShard));
+        }
+    }
+
+    //对key对应的会话做一次事件转换
+    //会话不存在则自动创建（初始Idle）
+    //非法转换或者shard满了返回false
+    bool handleEvent(std::uint64_t key, Event event){
+        std::uint64_t h = mix(key);
+        Shard &shard = shardFor(h);
+        std::size_t i = shard.findOrInsert(key, h);
+        if (i == shard.capacity()) return false;   //shard满
+        return shard.handleEventAt(i, event);
+    }
+
+    //查询会话状态，不存在返回false
+    bool getState(std::uint64_t key, State &out) const {
+        std::uint64_t h = mix(key);
+        const Shard &shard = shardFor(h);
+        std::size_t i = shard.find(key, h);
+        if (i == shard.capacity()) return false;
+        out = shard.stateAt(i);
+        return true;
+    }
+
+    //会话总数
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (const auto &s : shards_) n += s->size();
+        return n;
+    }
+
+    std::size_t shardCount() const { return shards_.size(); }
+
+    //批量遍历所有会话（fn(key, state)）
+    //遍历和并发更新不互斥，读到的是各槽位当时的快照
+    template <typename Fn>
+    void forEach(Fn &&fn) const {
+        for (const auto &s : shards_) s->forEach(fn);
+    }
+
+    //给所有会话广播同一个事件（恢复/回放路径）
+    //不走逐key的探测和CAS：先把“这个事件下每个状态去哪”
+    //预编成16字节映射（非法转换=原地不动），
+    //再对每个shard的紧凑状态数组线性扫一遍
+    //调用期间不能有并发的handleEvent（静止场景专用）
+    void broadcastEvent(Event event){
+        static_assert(kStateCount <= 16, "状态数超出pshufb一次能查的范围");
+        std::uint8_t lut[16];
+        for (std::size_t s = 0; s < 16; ++s){
+            State to;
+            lut[s] = (s < kStateCount &&
+                      transitionRules.find(static_cast<State>(s), event, to))
+                         ? static_cast<std::uint8_t>(to)
+                         : static_cast<std::uint8_t>(s);
+        }
+        for (auto &shard : shards_){
+            shard->bulkApply(lut);
+        }
+    }
+};
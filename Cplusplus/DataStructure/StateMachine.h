@@ -0,0 +1,610 @@
+/*
+    状态机核心
+        状态集合：
+            (当前状态，输入事件) -> 新的状态
+
+    原来用 std::map<std::tuple<State, Event>, State> 保存转换规则，
+    每次handleEvent()都要走一遍红黑树，还要做tuple比较，
+    在高事件速率下这部分查找就是主要开销。
+
+    现在改成按 [状态][事件] 索引的二维数组（TransitionTable），
+    一次查找就是一次数组访问，一条cache line就能装下整张表。
+    非法转换用哨兵值表示。
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+//有锁状态机
+#include <mutex>
+
+//无锁状态机
+#include <atomic>
+
+//回调delegate（内联存储 + RCU快照列表）
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <iostream>
+
+//状态枚举
+//空，运行，暂停，停止
+enum class State{
+    Idle,
+    Running,
+    Paused,
+    Stopped
+};
+
+//事件枚举
+enum class Event{
+    Start,
+    Pause,
+    Resume,
+    Stop
+};
+
+//状态和事件的个数，作为二维表的两个维度
+constexpr std::size_t kStateCount = 4;
+constexpr std::size_t kEventCount = 4;
+
+//
+inline std::vector<std::string> strState = {"Idle", "Running", "Paused", "Stopped"};
+
+//状态转换表
+//状态转换规则：当前状态 + 事件 -> 新状态
+//二维数组实现：next_[当前状态][事件] = 下一个状态
+//表里没有的转换填kInvalid
+class TransitionTable{
+public:
+    //非法转换哨兵
+    static constexpr std::int8_t kInvalid = -1;
+
+    constexpr TransitionTable(){
+        for (auto &row : next_){
+            for (auto &cell : row){
+                cell = kInvalid;
+            }
+        }
+    }
+
+    //添加一条规则：当前状态 + 事件 -> 新状态
+    constexpr void add(State from, Event event, State to){
+        next_[idx(from)][idx(event)] = static_cast<std::int8_t>(to);
+    }
+
+    //查找转换规则
+    //存在则写入to并返回true，非法转换返回false
+    constexpr bool find(State from, Event event, State &to) const {
+        std::int8_t n = next_[idx(from)][idx(event)];
+        if (n == kInvalid) return false;
+        to = static_cast<State>(n);
+        return true;
+    }
+
+private:
+    static constexpr std::size_t idx(State s){ return static_cast<std::size_t>(s); }
+    static constexpr std::size_t idx(Event e){ return static_cast<std::size_t>(e); }
+
+    std::array<std::array<std::int8_t, kEventCount>, kStateCount> next_{};
+};
+
+//默认转换规则，内容和原来map里的一致
+constexpr TransitionTable makeDefaultRules(){
+    TransitionTable t;
+    t.add(State::Idle, Event::Start, State::Running);
+    t.add(State::Running, Event::Pause, State::Paused);
+    t.add(State::Paused, Event::Resume, State::Running);
+    t.add(State::Running, Event::Stop, State::Stopped);
+    t.add(State::Paused, Event::Stop, State::Stopped);
+    return t;
+}
+
+inline constexpr TransitionTable transitionRules = makeDefaultRules();
+
+//转换轨迹
+//以前SyncStateMachine::handleEvent()持着锁往cout打印转换信息，
+//所有线程都被串在控制台I/O后面，每个事件多花几微秒
+//调试又确实需要转换历史，所以改成固定大小的无锁轨迹环：
+//热路径只做一次fetch_add加几个普通写，
+//历史由别的线程或者事后dump()倒出来
+struct TraceEntry{
+    State from;
+    Event event;
+    State to;
+    std::chrono::steady_clock::time_point when;
+};
+
+class TraceRing{
+private:
+    std::vector<TraceEntry> entries_;
+    std::size_t mask_;
+    std::atomic<std::size_t> writeIndex_{0};
+
+public:
+    //容量必须是2的幂，环满了最旧的记录被覆盖
+    explicit TraceRing(std::size_t capacity = 1024)
+        : entries_(capacity), mask_(capacity - 1){}
+
+    //热路径：抢一个槽位然后写进去
+    void record(State from, Event event, State to){
+        std::size_t i = writeIndex_.fetch_add(1, std::memory_order_relaxed);
+        TraceEntry &e = entries_[i & mask_];
+        e.from = from;
+        e.event = event;
+        e.to = to;
+        e.when = std::chrono::steady_clock::now();
+    }
+
+    //累计记录条数（可能超过容量）
+    std::size_t recorded() const { return writeIndex_.load(); }
+
+    //拷出当前还留在环里的记录，从旧到新
+    //读和写不同步：正在写的那条可能读到一半，调试用途可以接受
+    std::vector<TraceEntry> snapshot() const {
+        std::size_t written = writeIndex_.load();
+        std::size_t count = written < entries_.size() ? written : entries_.size();
+        std::vector<TraceEntry> out;
+        out.reserve(count);
+        for (std::size_t i = written - count; i < written; ++i){
+            out.push_back(entries_[i & mask_]);
+        }
+        return out;
+    }
+
+    //事后dump：把轨迹按原来的格式打出来
+    void dump(std::ostream &os) const {
+        for (const auto &e : snapshot()){
+            os << "Come in next status [" <<
+            strState[static_cast<int>(e.from)] <<
+                "] -> [" <<
+            strState[static_cast<int>(e.to)] << "]" << std::endl;
+        }
+    }
+};
+
+//批量处理的结果位图
+//第i位为1表示批次里第i个事件转换成功
+//事件一般按64~512个一批到达，所以底层是uint64_t数组
+struct EventResultBitmap{
+    std::vector<std::uint64_t> bits;
+
+    explicit EventResultBitmap(std::size_t n): bits((n + 63) / 64, 0){}
+
+    void set(std::size_t i){ bits[i / 64] |= (std::uint64_t{1} << (i % 64)); }
+    bool test(std::size_t i) const { return (bits[i / 64] >> (i % 64)) & 1; }
+};
+
+//编译期状态机
+//转换表作为模板参数传入（必须是constexpr的具名表，比如上面的transitionRules），
+//这样handleEvent()里的查表会被编译器折叠成对常量数组的访问：
+//没有堆分配，没有可变全局量，可以整体内联，
+//表里不可达的转换直接被优化掉
+//整个状态机也能放在constexpr上下文里跑（见StatusMachine.cpp里的static_assert）
+template <const TransitionTable &Table>
+class StaticStateMachine{
+private:
+    State currentState;
+public:
+    constexpr StaticStateMachine(): currentState(State::Idle){}
+
+    //处理事件：查常量表，成功则进入下一个状态
+    constexpr bool handleEvent(Event event){
+        State next;
+        if (Table.find(currentState, event, next)){
+            currentState = next;
+            return true;
+        }
+        return false;
+    }
+
+    constexpr State getCurrentState() const { return currentState; }
+};
+
+//转换动作
+//之前的做法是一个全局std::function回调，内部再对(旧状态,事件)做switch，
+//每个事件都要走一次分支很多的间接调用
+//现在把动作直接放进转换表：每条转换规则可以带一个动作函数，
+//每个状态可以带进入/退出动作，编译期就绑定好
+//配合下面的StaticActionMachine，常用路径（比如Running->Paused）
+//可以被编译器整体内联
+using TransitionAction = void (*)(State from, Event event, State to);
+using StateAction = void (*)(State state);
+
+class ActionTable{
+private:
+    TransitionTable table_;
+    std::array<std::array<TransitionAction, kEventCount>, kStateCount> actions_{};
+    std::array<StateAction, kStateCount> onEntry_{};
+    std::array<StateAction, kStateCount> onExit_{};
+
+    static constexpr std::size_t idx(State s){ return static_cast<std::size_t>(s); }
+    static constexpr std::size_t idx(Event e){ return static_cast<std::size_t>(e); }
+
+public:
+    constexpr ActionTable() = default;
+
+    //添加一条规则，action可以为空（纯转换）
+    constexpr void add(State from, Event event, State to,
+                       TransitionAction action = nullptr){
+        table_.add(from, event, to);
+        actions_[idx(from)][idx(event)] = action;
+    }
+
+    //进入/退出某个状态时的动作
+    constexpr void setEntry(State s, StateAction action){ onEntry_[idx(s)] = action; }
+    constexpr void setExit(State s, StateAction action){ onExit_[idx(s)] = action; }
+
+    constexpr bool find(State from, Event event, State &to) const {
+        return table_.find(from, event, to);
+    }
+
+    constexpr TransitionAction action(State from, Event event) const {
+        return actions_[idx(from)][idx(event)];
+    }
+    constexpr StateAction entryAction(State s) const { return onEntry_[idx(s)]; }
+    constexpr StateAction exitAction(State s) const { return onExit_[idx(s)]; }
+};
+
+//带动作的编译期状态机
+//表是constexpr的NTTP，动作是表里的函数指针常量，
+//handleEvent()里没有任何运行期查表之外的间接层
+//动作顺序：退出旧状态 -> 转换动作 -> 进入新状态
+template <const ActionTable &Table>
+class StaticActionMachine{
+private:
+    State currentState;
+public:
+    constexpr StaticActionMachine(): currentState(State::Idle){}
+
+    constexpr bool handleEvent(Event event){
+        State next;
+        if (!Table.find(currentState, event, next)){
+            return false;
+        }
+        if (StateAction exit = Table.exitAction(currentState)) exit(currentState);
+        if (TransitionAction act = Table.action(currentState, event)){
+            act(currentState, event, next);
+        }
+        if (StateAction entry = Table.entryAction(next)) entry(next);
+        currentState = next;
+        return true;
+    }
+
+    constexpr State getCurrentState() const { return currentState; }
+};
+
+//同步状态机？？
+class SyncStateMachine{
+private:
+    State currentState;
+    mutable std::mutex mtx;
+    //可选的转换轨迹环，不挂就零开销
+    TraceRing *trace_ = nullptr;
+
+public:
+    SyncStateMachine(): currentState(State::Idle){}
+
+    //挂上轨迹环后，每次成功转换记一条轨迹
+    void attachTrace(TraceRing *trace){ trace_ = trace; }
+
+    //当事件来的时候，看一下当前状态，事件，下一状态是否存在
+    //存在，则说明可以跳转到下一个状态
+    bool handleEvent(Event event){
+        //lock_gurad用于离开后自动解锁
+        std::lock_guard<std::mutex> lock(mtx);
+
+        //查找转换规则：一次数组访问
+        State next;
+        if (transitionRules.find(currentState, event, next))
+        {
+            //进入下一个状态
+            //注意这里不再打印：持锁做控制台I/O会把所有线程串行化，
+            //轨迹进环，由别的线程/事后dump
+            if (trace_) trace_->record(currentState, event, next);
+            currentState = next;
+            return true;    //转换成功
+        }
+        return false;
+    }
+
+    //批量处理事件
+    //网络线程收到的事件本来就是一批一批的，
+    //逐个handleEvent()就是每个事件一次加锁解锁，纯粹浪费
+    //这里整批只加一次锁，在锁内顺序走表
+    //返回位图：第i位表示第i个事件是否转换成功（批量路径不打印）
+    EventResultBitmap handleEvents(std::span<const Event> events){
+        EventResultBitmap result(events.size());
+        std::lock_guard<std::mutex> lock(mtx);
+        for (std::size_t i = 0; i < events.size(); ++i){
+            State next;
+            if (transitionRules.find(currentState, events[i], next)){
+                if (trace_) trace_->record(currentState, events[i], next);
+                currentState = next;
+                result.set(i);
+            }
+        }
+        return result;
+    }
+
+    //获取当前状态（线程安全）
+    State getCurrentState() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return currentState;
+    }
+
+};
+
+//无锁实现状态机
+//使用std::atomic替代锁
+//CAS重试的退避策略：attempt是本次事件已经失败的CAS次数
+//普通函数指针，和TransitionAction一个路数，地址可以随时换
+using BackoffPolicy = void(*)(unsigned attempt);
+
+//默认策略：有界指数退避，第n次失败自旋2^n个pause，封顶64
+//争用线程按失败次数错开重试时机，别一起挤在同一个缓存行上
+inline void exponentialBackoff(unsigned attempt)
+{
+    unsigned spins = 1u << (attempt < 6 ? attempt : 6);
+    for (unsigned i = 0; i < spins; ++i){
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::atomic_signal_fence(std::memory_order_seq_cst);   //防止空转被优化掉
+#endif
+    }
+}
+
+class LockFreeStateMachine{
+private:
+    std::atomic<State> currentState;
+    //可选的转换轨迹环
+    TraceRing *trace_ = nullptr;
+    //争用遥测：retries_是CAS失败重试的次数，failures_是被拒绝的事件数
+    //无争用时retries_路径根本不会走到，不影响快路径
+    std::atomic<std::uint64_t> retries_{0};
+    std::atomic<std::uint64_t> failures_{0};
+    BackoffPolicy backoff_ = exponentialBackoff;
+
+public:
+    LockFreeStateMachine() : currentState(State::Idle){}
+
+    void attachTrace(TraceRing *trace){ trace_ = trace; }
+
+    //换退避策略，nullptr表示不退避（纯自旋）
+    void setBackoff(BackoffPolicy policy){ backoff_ = policy; }
+
+    std::uint64_t retryCount() const { return retries_.load(); }
+    std::uint64_t failureCount() const { return failures_.load(); }
+
+    //处理事件
+    //compare_exchange失败时会把expected刷成最新状态，
+    //所以循环里不用重新load，查表也只在状态真变了之后才重做
+    bool handleEvent(Event event){
+        State expected = currentState.load();
+        State desired;
+        unsigned attempt = 0;
+        for (;;){
+            if (!transitionRules.find(expected, event, desired)){
+                failures_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            if (currentState.compare_exchange_weak(expected, desired)) break;
+            retries_.fetch_add(1, std::memory_order_relaxed);
+            if (backoff_) backoff_(attempt++);
+        }
+        if (trace_) trace_->record(expected, event, desired);
+        return true;
+    }
+
+    //批量处理事件
+    //先从当前状态出发在本地走完整批事件（不碰共享状态），
+    //最后只对最终状态做一次CAS；CAS失败说明别的线程改了状态，
+    //整批重走（位图也重算）
+    //把每个事件一次CAS摊薄成整批一次CAS
+    EventResultBitmap handleEvents(std::span<const Event> events){
+        State expected, local;
+        EventResultBitmap result(events.size());
+        unsigned attempt = 0;
+        for (;;){
+            expected = currentState.load();
+            local = expected;
+            result = EventResultBitmap(events.size());
+            std::size_t rejected = 0;
+            for (std::size_t i = 0; i < events.size(); ++i){
+                State next;
+                if (transitionRules.find(local, events[i], next)){
+                    local = next;
+                    result.set(i);
+                }else{
+                    ++rejected;
+                }
+            }
+            if (currentState.compare_exchange_weak(expected, local)){
+                failures_.fetch_add(rejected, std::memory_order_relaxed);
+                break;
+            }
+            //整批重走算一次重试
+            retries_.fetch_add(1, std::memory_order_relaxed);
+            if (backoff_) backoff_(attempt++);
+        }
+        //CAS成功后再把整批轨迹补进环（避免失败批次留下假轨迹）
+        if (trace_){
+            State s = expected;
+            for (std::size_t i = 0; i < events.size(); ++i){
+                if (result.test(i)){
+                    //位图置位了查表必然命中，但还是以查表结果为准：
+                    //万一走形了也不往环里塞没初始化的状态
+                    State next;
+                    if (transitionRules.find(s, events[i], next)){
+                        trace_->record(s, events[i], next);
+                        s = next;
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    State getCurrentState() const {
+        return currentState.load();
+    }
+};
+
+//转换回调的delegate
+//代替std::function：std::function遇到大一点的捕获就堆分配，
+//这里是固定48字节的内联存储，放不下的捕获直接编译报错
+//可拷贝（RCU快照换代时要整个列表拷一份）
+class TransitionDelegate{
+private:
+    static constexpr std::size_t kStorageSize = 48;
+
+    alignas(std::max_align_t) unsigned char storage_[kStorageSize];
+    void (*invoke_)(const void*, State, Event, State) = nullptr;
+    void (*copy_)(void*, const void*) = nullptr;
+    void (*destroy_)(void*) = nullptr;
+
+public:
+    TransitionDelegate() = default;
+
+    template <typename F>
+        requires (!std::is_same_v<std::decay_t<F>, TransitionDelegate>)
+    TransitionDelegate(F f){
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= kStorageSize,
+                      "捕获太大，放不进delegate的内联存储");
+        new (storage_) Fn(std::move(f));
+        invoke_ = [](const void *p, State from, Event event, State to){
+            (*static_cast<const Fn*>(p))(from, event, to);
+        };
+        copy_ = [](void *dst, const void *src){
+            new (dst) Fn(*static_cast<const Fn*>(src));
+        };
+        destroy_ = [](void *p){ static_cast<Fn*>(p)->~Fn(); };
+    }
+
+    TransitionDelegate(const TransitionDelegate &other)
+        : invoke_(other.invoke_), copy_(other.copy_), destroy_(other.destroy_)
+    {
+        if (copy_) copy_(storage_, other.storage_);
+    }
+
+    TransitionDelegate &operator=(const TransitionDelegate &other){
+        if (this != &other){
+            if (destroy_) destroy_(storage_);
+            invoke_ = other.invoke_;
+            copy_ = other.copy_;
+            destroy_ = other.destroy_;
+            if (copy_) copy_(storage_, other.storage_);
+        }
+        return *this;
+    }
+
+    ~TransitionDelegate(){
+        if (destroy_) destroy_(storage_);
+    }
+
+    void operator()(State from, Event event, State to) const {
+        invoke_(storage_, from, event, to);
+    }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+};
+
+class SyncStateMachine_Callback{
+private:
+    State currentState;
+    mutable std::mutex mtx;
+
+    //观察者列表，RCU风格：
+    //读端（handleEvent）只做一次shared_ptr的原子load，拿到的快照在锁外遍历，
+    //写端（setCallback/addCallback）拷一份新列表再原子替换，
+    //注册回调永远不会阻塞事件处理
+    using CallbackList = std::vector<TransitionDelegate>;
+    std::atomic<std::shared_ptr<const CallbackList>> callbacks_{nullptr};
+    std::mutex registerMtx_;   //只用于写端互相排队
+
+    //在状态锁外分发：慢的观察者不会卡住别的事件生产者
+    //代价是高并发下观察者看到的通知顺序可能和转换顺序有出入
+    void dispatch(State from, Event event, State to){
+        auto snapshot = callbacks_.load();
+        if (!snapshot) return;
+        for (const auto &cb : *snapshot){
+            cb(from, event, to);
+        }
+    }
+
+public:
+
+    SyncStateMachine_Callback(): currentState(State::Idle){}
+
+    //替换成单个回调（保持原有接口语义）
+    void setCallback(TransitionDelegate callback){
+        std::lock_guard<std::mutex> lock(registerMtx_);
+        auto list = std::make_shared<CallbackList>();
+        list->push_back(std::move(callback));
+        callbacks_.store(std::move(list));
+    }
+
+    //追加一个回调：拷一份旧列表，加上新的，原子换代
+    void addCallback(TransitionDelegate callback){
+        std::lock_guard<std::mutex> lock(registerMtx_);
+        auto old = callbacks_.load();
+        auto list = old ? std::make_shared<CallbackList>(*old)
+                        : std::make_shared<CallbackList>();
+        list->push_back(std::move(callback));
+        callbacks_.store(std::move(list));
+    }
+
+    //事件处理函数
+    bool handleEvent(Event event){
+        State oldState, next;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!transitionRules.find(currentState, event, next)){
+                return false;
+            }
+            oldState = currentState;
+            currentState = next;
+        }
+        //锁已释放，再通知观察者
+        dispatch(oldState, event, next);
+        return true;
+    }
+
+    State getCurrentState() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return currentState;
+    }
+
+    //批量处理事件：整批只加一次锁，回调在锁外统一分发
+    EventResultBitmap handleEvents(std::span<const Event> events){
+        EventResultBitmap result(events.size());
+        struct Transition{ State from; Event event; State to; };
+        std::vector<Transition> done;
+        done.reserve(events.size());
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (std::size_t i = 0; i < events.size(); ++i){
+                State next;
+                if (transitionRules.find(currentState, events[i], next)){
+                    done.push_back({currentState, events[i], next});
+                    currentState = next;
+                    result.set(i);
+                }
+            }
+        }
+        for (const auto &t : done){
+            dispatch(t.from, t.event, t.to);
+        }
+        return result;
+    }
+
+};
@@ -0,0 +1,208 @@
+/*
+    三个状态机实现的基准测试
+        SyncStateMachine（互斥锁）
+        LockFreeStateMachine（CAS）
+        SyncStateMachine_Callback（锁 + 锁外回调分发）
+
+    测量内容：
+        单线程延迟：ns/事件、cycles/事件（x86上用rdtsc）
+        多线程吞吐：1~32线程打同一台机器（争用）和各打各的机器（无争用）
+
+    不依赖google-benchmark，自己计时：
+        每个用例先热身一轮，再计时
+    带重试计数器的机器（LockFreeStateMachine）额外报告CAS重试率，
+    最后还有一组退避策略的开关对比
+
+    编译：g++ -std=c++20 -O2 -pthread StatusMachineBench.cpp
+*/
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+//事件轮换序列
+//注意不能带Stop：Stopped是吸收态，进去就再也转换不出来，
+//后面全是失败路径，测出来的就不是转换开销了
+//用Pause/Resume让机器一直在Running和Paused之间转换，
+//序列里保留Start制造一定比例的失败路径
+constexpr Event kEventCycle[] = {Event::Start, Event::Pause,
+                                 Event::Resume, Event::Pause};
+
+static inline uint64_t readCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;   //非x86平台只报ns
+#endif
+}
+
+//单线程延迟：machine连续吃n个事件
+template <typename Machine>
+void benchSingleThread(const char *name, size_t n)
+{
+    Machine machine;
+    //热身
+    for (size_t i = 0; i < n / 10; ++i){
+        machine.handleEvent(kEventCycle[i % 4]);
+    }
+
+    auto t0 = Clock::now();
+    uint64_t c0 = readCycles();
+    size_t ok = 0;
+    for (size_t i = 0; i < n; ++i){
+        ok += machine.handleEvent(kEventCycle[i % 4]);
+    }
+    uint64_t c1 = readCycles();
+    auto t1 = Clock::now();
+
+    double ns = chrono::duration<double, nano>(t1 - t0).count();
+    cout << left << setw(28) << name
+         << fixed << setprecision(1)
+         << setw(10) << ns / n << "ns/ev  ";
+    if (c1 > c0){
+        cout << setw(8) << double(c1 - c0) / n << "cyc/ev  ";
+    }
+    cout << "accepted " << ok * 100 / n << "%" << endl;
+}
+
+//多线程吞吐
+//contended=true：所有线程打同一台机器
+//contended=false：每个线程一台自己的机器（测扩展性上限）
+template <typename Machine>
+void benchThreads(const char *name, size_t threads, size_t perThread,
+                  bool contended)
+{
+    vector<unique_ptr<Machine>> machines;
+    size_t machineCount = contended ? 1 : threads;
+    for (size_t i = 0; i < machineCount; ++i){
+        machines.push_back(make_unique<Machine>());
+    }
+
+    atomic<bool> go{false};
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t){
+        workers.emplace_back([&, t]{
+            Machine &m = *machines[contended ? 0 : t];
+            while (!go.load()) { /* 等所有线程就位 */ }
+            for (size_t i = 0; i < perThread; ++i){
+                m.handleEvent(kEventCycle[i % 4]);
+            }
+        });
+    }
+
+    auto t0 = Clock::now();
+    go.store(true);
+    for (auto &w : workers) w.join();
+    auto t1 = Clock::now();
+
+    double sec = chrono::duration<double>(t1 - t0).count();
+    double mops = double(threads * perThread) / sec / 1e6;
+    cout << left << setw(28) << name
+         << setw(3) << threads << "线程  "
+         << (contended ? "争用  " : "独立  ")
+         << fixed << setprecision(1) << mops << " M事件/秒";
+    //带重试计数器的机器顺带报告CAS重试率
+    if constexpr (requires(Machine &m){ m.retryCount(); }){
+        uint64_t retries = 0;
+        for (auto &m : machines) retries += m->retryCount();
+        cout << "  重试率 " << setprecision(2)
+             << retries * 100.0 / double(threads * perThread) << "%";
+    }
+    cout << endl;
+}
+
+//退避策略对比：同样的争用负载，开/关指数退避各跑一遍
+void benchBackoff(size_t threads, size_t perThread, BackoffPolicy policy,
+                  const char *label)
+{
+    LockFreeStateMachine machine;
+    machine.setBackoff(policy);
+
+    atomic<bool> go{false};
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t){
+        workers.emplace_back([&]{
+            while (!go.load()) { /* 等所有线程就位 */ }
+            for (size_t i = 0; i < perThread; ++i){
+                machine.handleEvent(kEventCycle[i % 4]);
+            }
+        });
+    }
+    auto t0 = Clock::now();
+    go.store(true);
+    for (auto &w : workers) w.join();
+    auto t1 = Clock::now();
+
+    double sec = chrono::duration<double>(t1 - t0).count();
+    cout << left << setw(28) << label
+         << setw(3) << threads << "线程  争用  "
+         << fixed << setprecision(1)
+         << double(threads * perThread) / sec / 1e6 << " M事件/秒"
+         << "  重试率 " << setprecision(2)
+         << machine.retryCount() * 100.0 / double(threads * perThread)
+         << "%" << endl;
+}
+
+int main()
+{
+    constexpr size_t kSingleN = 2000000;
+    constexpr size_t kPerThread = 500000;
+
+    cout << "==== 单线程延迟 ====" << endl;
+    benchSingleThread<SyncStateMachine>("SyncStateMachine", kSingleN);
+    benchSingleThread<LockFreeStateMachine>("LockFreeStateMachine", kSingleN);
+    benchSingleThread<SyncStateMachine_Callback>("SyncStateMachine_Callback", kSingleN);
+
+    //回调机挂上一个轻量回调再测一次（更接近实际用法）
+    {
+        SyncStateMachine_Callback machine;
+        atomic<size_t> fired{0};
+        machine.setCallback([&fired](State, Event, State){ fired.fetch_add(1); });
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < kSingleN; ++i){
+            machine.handleEvent(kEventCycle[i % 4]);
+        }
+        auto t1 = Clock::now();
+        double ns = chrono::duration<double, nano>(t1 - t0).count();
+        cout << left << setw(28) << "  ...带回调" << fixed << setprecision(1)
+             << setw(10) << ns / kSingleN << "ns/ev  (fired "
+             << fired.load() << ")" << endl;
+    }
+
+    size_t hw = thread::hardware_concurrency();
+    cout << "\n==== 多线程吞吐（硬件线程数 " << hw << "）====" << endl;
+    for (size_t threads : {1u, 2u, 4u, 8u, 16u, 32u}){
+        if (threads > hw * 2) break;
+        benchThreads<SyncStateMachine>("SyncStateMachine", threads, kPerThread, true);
+        benchThreads<LockFreeStateMachine>("LockFreeStateMachine", threads, kPerThread, true);
+        benchThreads<SyncStateMachine_Callback>("SyncStateMachine_Callback", threads, kPerThread, true);
+    }
+
+    cout << "\n==== 无争用对照（每线程一台机器）====" << endl;
+    for (size_t threads : {1u, 4u}){
+        if (threads > hw) break;
+        benchThreads<SyncStateMachine>("SyncStateMachine", threads, kPerThread, false);
+        benchThreads<LockFreeStateMachine>("LockFreeStateMachine", threads, kPerThread, false);
+    }
+
+    cout << "\n==== CAS退避策略对比 ====" << endl;
+    {
+        size_t threads = hw < 8 ? (hw ? hw : 1) : 8;
+        benchBackoff(threads, kPerThread, nullptr, "无退避（纯自旋）");
+        benchBackoff(threads, kPerThread, exponentialBackoff, "有界指数退避");
+    }
+    return 0;
+}
@@ -1,18 +1,7 @@
 /*
-    调度器
-        管理任务队列
-        按照一定策略执行任务
-            FIFO
-            优先级调度
-            轮转调度
-    调度器的工作就是选择一个任务，执行这个任务
-
-    首先需要要给任务类，可派生出各种任务
-    然后需要一个策略类，可以让调度器按照这个策略执行
-    最后就是一个调度器类，执行调度
-*/
+    调度器演示
+        任务类、策略类、调度器类本体在TaskScheduler.h
 
-/*
 设计任务类，策略类，调度器类
 
 任务类：
@@ -24,137 +13,13 @@
 
 调度器类：
     需要策略类进行初始化
-
-
-关键设计点
-    ‌智能指针管理‌：
-        使用 unique_ptr 明确资源所有权
-        避免内存泄漏和悬空指针
-    ‌策略模式‌：
-        将算法（调度策略）抽象为独立对象
-        运行时动态切换算法
-    ‌类型擦除‌：
-        通过基类指针操作各种派生类对象
-        统一处理不同类型的任务和策略
-
 */
 
+#include "TaskScheduler.h"
+
+#include <atomic>
 #include <iostream>
 #include <memory>
-#include <queue>
-#include <vector>
-#include <vector>
-#include <functional>
-
-//任务基类
-//任务的执行
-//任务优先级
-class Task{
-public:
-    virtual void execute() = 0;
-    virtual ~Task() = default;
-    virtual int getPriority() const { return 0; }
-};
-
-//具体任务
-class PrintTask: public Task{
-    std::string message_;
-public:
-    explicit PrintTask(std::string msg): message_(std::move(msg)) {}
-    void execute() override{
-        std::cout << "Executing: " << message_ << std::endl;
-    }
-};
-
-//带优先级的任务
-class PriorityTask: public Task{
-    std::string message_;
-    int priority_;
-public:
-    PriorityTask(std::string msg, int prio)
-        : message_(std::move(msg)), priority_(prio) {}
-    
-    void execute() override{
-        std::cout << "[P" << priority_ << "]" << message_ << std::endl;
-    }
-
-    int getPriority() const override { return priority_; }
-};
-
-//调度策略接口
-//抽象基类，只有接口，没有数据结构
-//调度类负责选择一个任务执行
-//调度类负责添加一个任务到队列中
-class SchedulingStrategy{
-public:
-    virtual void addTask(std::unique_ptr<Task> task) = 0;
-    virtual std::unique_ptr<Task> getNextTask() = 0;
-    virtual ~SchedulingStrategy() = default;
-};
-
-//具体策略类：先进先出（继承实现策略）
-class FifoStrategy: public SchedulingStrategy{
-    //先进先出队列
-    //即普通队列
-    std::queue<std::unique_ptr<Task>> queue_;
-public:
-    void addTask(std::unique_ptr<Task> task){
-        queue_.push(std::move(task));
-    }
-    std::unique_ptr<Task> getNextTask() override{
-        if (queue_.empty()) return nullptr;
-        auto task = std::move(queue_.front());
-        queue_.pop();
-        return task;
-    }
-};
-
-//优先级队列
-//最小堆模式
-//
-class PriorityStrategy: public SchedulingStrategy{
-    struct TaskComparator{
-        bool operator() (const std::unique_ptr<Task>& a, 
-                            const std::unique_ptr<Task>& b)
-        {
-            return a->getPriority() > b->getPriority(); //最小堆
-        }
-    };
-    std::priority_queue<
-        std::unique_ptr<Task>,
-        std::vector<std::unique_ptr<Task>>,
-        TaskComparator> pq_;
-
-public:
-    void addTask(std::unique_ptr<Task> task) override{
-        pq_.push(std::move(task));
-    }
-    std::unique_ptr<Task> getNextTask() override{
-        if (pq_.empty()) return nullptr;
-        auto task = std::move(const_cast<std::unique_ptr<Task>&>(pq_.top()));
-        pq_.pop();
-        return task;
-    }
-};
-
-//调度器
-//需要一个策略进行初始化
-class Scheduler{
-    std::unique_ptr<SchedulingStrategy> strategy_;
-public:
-    explicit Scheduler(std::unique_ptr<SchedulingStrategy> strategy)
-        : strategy_(std::move(strategy)) {}
-    
-    void submit(std::unique_ptr<Task> task){
-        strategy_->addTask(std::move(task));
-    }
-
-    void run(){
-        while(auto task = strategy_->getNextTask()){
-            task->execute();
-        }
-    }
-};
 
 int main()
 {
@@ -162,26 +27,307 @@ int main()
     {
         auto strategy = std::make_unique<FifoStrategy>();
         Scheduler scheduler(std::move(strategy));
-        
+
         scheduler.submit(std::make_unique<PrintTask>("First"));
         scheduler.submit(std::make_unique<PrintTask>("Second"));
         scheduler.submit(std::make_unique<PrintTask>("Third"));
-        
+
         std::cout << "FIFO Schedule:" << std::endl;
-        scheduler.run(); 
+        scheduler.run();
     }
 
     //优先级策略演示
     {
         auto strategy = std::make_unique<PriorityStrategy>();
         Scheduler scheduler(std::move(strategy));
-        
+
         scheduler.submit(std::make_unique<PriorityTask>("Low", 3));
         scheduler.submit(std::make_unique<PriorityTask>("Urgent", 1));
         scheduler.submit(std::make_unique<PriorityTask>("Medium", 2));
-        
+
         std::cout << "\nPriority Schedule:" << std::endl;
         scheduler.run();
     }
+
+    //线程池调度器演示：提交即异步执行，多个核一起消费
+    {
+        std::cout << "\nThreadPool Schedule:" << std::endl;
+
+        //用一个计数任务验证所有任务都被执行了
+        class CountTask: public Task{
+            std::atomic<int> &counter_;
+        public:
+            explicit CountTask(std::atomic<int> &c): counter_(c) {}
+            void execute() override{ counter_.fetch_add(1); }
+        };
+
+        std::atomic<int> done{0};
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 4);
+        for (int i = 0; i < 1000; ++i){
+            pool.submit(std::make_unique<CountTask>(done));
+        }
+        pool.wait();
+        std::cout << "executed: " << done.load() << "/1000" << std::endl;
+    }
+
+    //4叉堆优先级策略演示：和PriorityStrategy同样的语义，更少的cache miss
+    {
+        auto strategy = std::make_unique<DaryHeapStrategy>();
+        Scheduler scheduler(std::move(strategy));
+
+        scheduler.submit(std::make_unique<PriorityTask>("Low", 3));
+        scheduler.submit(std::make_unique<PriorityTask>("Urgent", 1));
+        scheduler.submit(std::make_unique<PriorityTask>("Medium", 2));
+
+        std::cout << "\nDaryHeap Schedule:" << std::endl;
+        scheduler.run();
+    }
+
+    //公平份额演示：三个租户权重4:2:1，谁都不会被饿死
+    {
+        std::cout << "\nFairShare Schedule (weights 4:2:1):" << std::endl;
+        Scheduler scheduler(std::make_unique<FairShareStrategy>(
+            std::vector<std::uint32_t>{4, 2, 1}));
+        for (int i = 0; i < 4; ++i){
+            scheduler.submit(std::make_unique<PriorityTask>("tenant0", 0));
+            scheduler.submit(std::make_unique<PriorityTask>("tenant1", 1));
+            scheduler.submit(std::make_unique<PriorityTask>("tenant2", 2));
+        }
+        scheduler.run();
+    }
+
+    //TaskFn演示：lambda直接提交，不定义任务类，捕获住在内联存储里
+    {
+        std::cout << "\nTaskFn Schedule:" << std::endl;
+        Scheduler scheduler(std::make_unique<PriorityStrategy>());
+        int sum = 0;
+        scheduler.submit(TaskFn([&sum]{ sum += 1; }, 2));
+        scheduler.submit(TaskFn([&sum]{ sum *= 10; }, 1));   //优先级高，先跑
+        scheduler.submit(TaskFn([&sum]{
+            std::cout << "sum = " << sum << std::endl;
+        }, 3));
+        scheduler.run();   //0*10+1=1
+    }
+
+    //任务池演示：任务对象来自slab池，销毁后槽位回池复用
+    {
+        std::cout << "\nPooled Tasks:" << std::endl;
+        Scheduler scheduler(std::make_unique<FifoStrategy>());
+        scheduler.submit(scheduler.make_task<PrintTask>("from pool"));
+        scheduler.submit(scheduler.make_task<PriorityTask>("also pooled", 1));
+        scheduler.run();
+    }
+
+    //工作窃取演示：每个工作线程一个deque，空了就随机偷别人的
+    {
+        std::cout << "\nWorkStealing Schedule:" << std::endl;
+
+        class CountTask: public Task{
+            std::atomic<int> &counter_;
+        public:
+            explicit CountTask(std::atomic<int> &c): counter_(c) {}
+            void execute() override{ counter_.fetch_add(1); }
+        };
+
+        std::atomic<int> done{0};
+        ThreadPoolScheduler pool(std::make_unique<WorkStealingStrategy>(4), 4);
+        for (int i = 0; i < 10000; ++i){
+            pool.submit(std::make_unique<CountTask>(done));
+        }
+        pool.wait();
+        std::cout << "executed: " << done.load() << "/10000" << std::endl;
+    }
+
+    //延迟任务演示：时间轮定时，到期后走普通队列执行
+    {
+        std::cout << "\nTimer Wheel:" << std::endl;
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 2);
+        auto t0 = std::chrono::steady_clock::now();
+        auto elapsedMs = [t0]{
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+        };
+        pool.submitAfter(std::chrono::milliseconds(50), TaskFn([&]{
+            std::cout << "  +50ms task at " << elapsedMs() << "ms" << std::endl;
+        }));
+        pool.submitAfter(std::chrono::milliseconds(10), TaskFn([&]{
+            std::cout << "  +10ms task at " << elapsedMs() << "ms" << std::endl;
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        pool.wait();
+    }
+
+    //无锁MPMC队列演示：多生产者多工作线程，没有全局锁
+    {
+        std::cout << "\nMPMC Fifo:" << std::endl;
+
+        class CountTask: public Task{
+            std::atomic<int> &counter_;
+        public:
+            explicit CountTask(std::atomic<int> &c): counter_(c) {}
+            void execute() override{ counter_.fetch_add(1); }
+        };
+
+        std::atomic<int> done{0};
+        ThreadPoolScheduler pool(std::make_unique<MpmcFifoStrategy>(1024), 4);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 4; ++p){
+            producers.emplace_back([&]{
+                for (int i = 0; i < 2500; ++i){
+                    pool.submit(pool.make_task<CountTask>(done));
+                }
+            });
+        }
+        for (auto &t : producers) t.join();
+        pool.wait();
+        std::cout << "executed: " << done.load() << "/10000" << std::endl;
+    }
+
+    //NUMA亲和演示：两个节点各一份FIFO队列
+    //任务按亲和提示进对应节点，worker先吃本节点，空了才跨节点
+    {
+        std::cout << "\nNUMA-aware Schedule:" << std::endl;
+
+        auto makeNodes = []{
+            std::vector<std::unique_ptr<SchedulingStrategy>> perNode;
+            perNode.push_back(std::make_unique<FifoStrategy>());
+            perNode.push_back(std::make_unique<FifoStrategy>());
+            return perNode;
+        };
+
+        std::atomic<int> done{0};
+        {
+            ThreadPoolScheduler pool(
+                std::make_unique<NumaAwareStrategy>(makeNodes()), 2);
+            for (int i = 0; i < 1000; ++i){
+                pool.submit(TaskFn([&done]{ done.fetch_add(1); }), i % 2);
+            }
+            pool.wait();
+        }
+        std::cout << "executed (alternating affinity): "
+                  << done.load() << "/1000" << std::endl;
+
+        //只有1个worker（归属节点0），任务全提示到节点1：
+        //本节点空，靠跨节点回退照样全部消化
+        done.store(0);
+        {
+            ThreadPoolScheduler pool(
+                std::make_unique<NumaAwareStrategy>(makeNodes()), 1);
+            for (int i = 0; i < 1000; ++i){
+                pool.submit(TaskFn([&done]{ done.fetch_add(1); }), 1);
+            }
+            pool.wait();
+        }
+        std::cout << "executed (cross-node fallback): "
+                  << done.load() << "/1000" << std::endl;
+    }
+
+    //协程任务演示：任务在yield点让出工作线程，大量在途任务复用少量线程
+    {
+        std::cout << "\nCoroutine Tasks:" << std::endl;
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 2);
+        std::atomic<int> finished{0};
+
+        //一个三阶段的流水线任务，阶段之间让出线程
+        auto pipeline = [](ThreadPoolScheduler &pool,
+                           std::atomic<int> &finished) -> CoTask {
+            co_await pool.yield();   //阶段1之后重新排队
+            co_await pool.yield();   //阶段2之后重新排队
+            finished.fetch_add(1);   //阶段3
+        };
+
+        for (int i = 0; i < 1000; ++i){
+            pool.submit(pipeline(pool, finished));
+        }
+        //协程在yield之间不占线程，1000个在途任务两个线程就够
+        while (finished.load() < 1000){
+            std::this_thread::yield();
+        }
+        pool.wait();
+        std::cout << "finished: " << finished.load() << "/1000" << std::endl;
+    }
+
+    //依赖DAG演示：菱形依赖 A -> (B, C) -> D
+    //D在B和C都完成的瞬间就绪，不需要阶段屏障
+    {
+        std::cout << "\nDAG Dependencies:" << std::endl;
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 4);
+        std::atomic<int> order{0};
+        auto step = [&order](const char *name){
+            return TaskFn([&order, name]{
+                std::cout << "  #" << order.fetch_add(1) + 1
+                          << " " << name << std::endl;
+            });
+        };
+        auto a = pool.submit(step("A"), {});
+        auto b = pool.submit(step("B"), {a});
+        auto c = pool.submit(step("C"), {a});
+        auto d = pool.submit(step("D"), {b, c});
+        pool.wait();
+
+        //已完成的句柄也能当依赖：直接就地入队
+        pool.submit(step("E (after finished D)"), {d});
+        pool.wait();
+    }
+
+    //结果通道演示：任务带返回值，then()把下一级排回队列
+    //共享状态在池槽位里，整条链路零堆分配
+    {
+        std::cout << "\nResult Channel:" << std::endl;
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 2);
+
+        //单级：提交拿句柄，get()收值
+        auto h = pool.submitWithResult<int>([]{ return 6 * 7; });
+        std::cout << "get() -> " << h.get() << std::endl;
+
+        //多级流水线：每级转换一次值，then()链式挂接
+        std::atomic<bool> finished{false};
+        pool.submitWithResult<int>([]{ return 1; })
+            .then([](int v){ return v + 10; })
+            .then([](int v){ return v * 3; })
+            .then([](int v){ return v - 3; })
+            .then([&](int v){
+                std::cout << "pipeline -> " << v << std::endl;   //(1+10)*3-3=30
+                finished.store(true);
+            });
+        while (!finished.load()){
+            std::this_thread::yield();
+        }
+        pool.wait();
+    }
+
+    //批量接口演示：一批任务一次交给调度器
+    {
+        std::cout << "\nBatch Submit:" << std::endl;
+
+        class CountTask: public Task{
+            std::atomic<int> &counter_;
+        public:
+            explicit CountTask(std::atomic<int> &c): counter_(c) {}
+            void execute() override{ counter_.fetch_add(1); }
+        };
+
+        std::atomic<int> done{0};
+        ThreadPoolScheduler pool(std::make_unique<FifoStrategy>(), 4);
+        for (int round = 0; round < 100; ++round){
+            std::vector<std::unique_ptr<Task>> batch;
+            batch.reserve(64);
+            for (int i = 0; i < 64; ++i){
+                batch.push_back(pool.make_task<CountTask>(done));
+            }
+            pool.submitBatch(std::move(batch));
+        }
+        pool.wait();
+        std::cout << "executed: " << done.load() << "/6400" << std::endl;
+
+        //统计快照：队列深度、等待/执行延迟分位数
+        auto stats = pool.statsSnapshot();
+        std::cout << "stats: submitted=" << stats.submitted
+                  << " executed=" << stats.executed
+                  << " depth=" << stats.queueDepth
+                  << " wait_p50=" << stats.waitNs(0.5) << "ns"
+                  << " wait_p99=" << stats.waitNs(0.99) << "ns"
+                  << " exec_p50=" << stats.execNs(0.5) << "ns" << std::endl;
+    }
     return 0;
 }
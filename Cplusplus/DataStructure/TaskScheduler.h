@@ -0,0 +1,1631 @@
+/*
+    调度器
+        管理任务队列
+        按照一定策略执行任务
+            FIFO
+            优先级调度
+            轮转调度
+    调度器的工作就是选择一个任务，执行这个任务
+
+    首先需要要给任务类，可派生出各种任务
+    然后需要一个策略类，可以让调度器按照这个策略执行
+    最后就是一个调度器类，执行调度
+
+关键设计点
+    ‌智能指针管理‌：
+        使用 unique_ptr 明确资源所有权
+        避免内存泄漏和悬空指针
+    ‌策略模式‌：
+        将算法（调度策略）抽象为独立对象
+        运行时动态切换算法
+    ‌类型擦除‌：
+        通过基类指针操作各种派生类对象
+        统一处理不同类型的任务和策略
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//任务基类
+//任务的执行
+//任务优先级
+class Task{
+public:
+    virtual void execute() = 0;
+    virtual ~Task() = default;
+    virtual int getPriority() const { return 0; }
+
+    //NUMA亲和提示：希望在哪个节点上执行，-1表示无所谓
+    //只有感知亲和的策略（NumaAwareStrategy）会看这个字段
+    virtual int getAffinity() const { return -1; }
+};
+
+//具体任务
+class PrintTask: public Task{
+    std::string message_;
+public:
+    explicit PrintTask(std::string msg): message_(std::move(msg)) {}
+    void execute() override{
+        std::cout << "Executing: " << message_ << std::endl;
+    }
+};
+
+//带优先级的任务
+class PriorityTask: public Task{
+    std::string message_;
+    int priority_;
+public:
+    PriorityTask(std::string msg, int prio)
+        : message_(std::move(msg)), priority_(prio) {}
+
+    void execute() override{
+        std::cout << "[P" << priority_ << "]" << message_ << std::endl;
+    }
+
+    int getPriority() const override { return priority_; }
+};
+
+//小对象任务类型
+//热路径上每个任务都走unique_ptr<Task>的话，
+//分配器和虚表缺失在高提交率下是大头
+//TaskFn是move-only的值类型：
+//    lambda直接构造进48字节的内联存储，不碰堆（放不下编译报错）
+//    优先级是内联字段，取优先级不再是一次虚调用
+//Task基类保留给真正的大任务，热路径用TaskFn
+class TaskFn{
+private:
+    static constexpr std::size_t kStorageSize = 48;
+
+    alignas(std::max_align_t) unsigned char storage_[kStorageSize];
+    void (*invoke_)(void*) = nullptr;
+    void (*relocate_)(void *dst, void *src) = nullptr;   //move构造+销毁源
+    void (*destroy_)(void*) = nullptr;
+    int priority_ = 0;
+
+public:
+    TaskFn() = default;
+
+    template <typename F>
+        requires (!std::is_same_v<std::decay_t<F>, TaskFn> &&
+                  std::is_invocable_v<std::decay_t<F>&>)
+    TaskFn(F f, int priority = 0): priority_(priority){
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= kStorageSize,
+                      "捕获太大，放不进TaskFn的内联存储");
+        new (storage_) Fn(std::move(f));
+        invoke_ = [](void *p){ (*static_cast<Fn*>(p))(); };
+        relocate_ = [](void *dst, void *src){
+            Fn *s = static_cast<Fn*>(src);
+            new (dst) Fn(std::move(*s));
+            s->~Fn();
+        };
+        destroy_ = [](void *p){ static_cast<Fn*>(p)->~Fn(); };
+    }
+
+    TaskFn(TaskFn &&other) noexcept
+        : invoke_(other.invoke_), relocate_(other.relocate_),
+          destroy_(other.destroy_), priority_(other.priority_)
+    {
+        if (relocate_) relocate_(storage_, other.storage_);
+        other.invoke_ = nullptr;
+        other.relocate_ = nullptr;
+        other.destroy_ = nullptr;
+    }
+
+    TaskFn &operator=(TaskFn &&other) noexcept{
+        if (this != &other){
+            if (destroy_) destroy_(storage_);
+            invoke_ = other.invoke_;
+            relocate_ = other.relocate_;
+            destroy_ = other.destroy_;
+            priority_ = other.priority_;
+            if (relocate_) relocate_(storage_, other.storage_);
+            other.invoke_ = nullptr;
+            other.relocate_ = nullptr;
+            other.destroy_ = nullptr;
+        }
+        return *this;
+    }
+
+    TaskFn(const TaskFn&) = delete;
+    TaskFn &operator=(const TaskFn&) = delete;
+
+    ~TaskFn(){
+        if (destroy_) destroy_(storage_);
+    }
+
+    void operator()(){ invoke_(storage_); }
+    int getPriority() const { return priority_; }
+    explicit operator bool() const { return invoke_ != nullptr; }
+};
+
+//让TaskFn能进现有的策略队列：一层薄的Task适配
+//节点是固定大小的，后面换成池分配就完全不走malloc了
+class FnTask: public Task{
+    TaskFn fn_;
+public:
+    explicit FnTask(TaskFn fn): fn_(std::move(fn)) {}
+    void execute() override{ fn_(); }
+    int getPriority() const override{ return fn_.getPriority(); }
+};
+
+//调度策略接口
+//抽象基类，只有接口，没有数据结构
+//调度类负责选择一个任务执行
+//调度类负责添加一个任务到队列中
+class SchedulingStrategy{
+public:
+    virtual void addTask(std::unique_ptr<Task> task) = 0;
+    virtual std::unique_ptr<Task> getNextTask() = 0;
+
+    //批量接口
+    //生产者一次交一批（64个量级），消费者一次取一块，
+    //队列操作和上层的锁往返都被摊薄到整批上
+    //默认实现逐个转发，具体策略可以整块做得更好
+    virtual void addTasks(std::vector<std::unique_ptr<Task>> tasks){
+        for (auto &t : tasks){
+            addTask(std::move(t));
+        }
+    }
+
+    //最多取out.size()个任务写进out，返回实际取到的个数
+    virtual std::size_t getNextTasks(std::span<std::unique_ptr<Task>> out){
+        std::size_t n = 0;
+        while (n < out.size()){
+            auto task = getNextTask();
+            if (!task) break;
+            out[n++] = std::move(task);
+        }
+        return n;
+    }
+
+    //策略自己是否线程安全
+    //不安全的策略由调度器统一加锁访问（默认）
+    //安全的策略（如工作窃取）多线程直接并发调用，不走全局锁
+    virtual bool isThreadSafe() const { return false; }
+
+    virtual ~SchedulingStrategy() = default;
+};
+
+//具体策略类：先进先出（继承实现策略）
+class FifoStrategy: public SchedulingStrategy{
+    //先进先出队列
+    //即普通队列
+    std::queue<std::unique_ptr<Task>> queue_;
+public:
+    void addTask(std::unique_ptr<Task> task) override{
+        queue_.push(std::move(task));
+    }
+    std::unique_ptr<Task> getNextTask() override{
+        if (queue_.empty()) return nullptr;
+        auto task = std::move(queue_.front());
+        queue_.pop();
+        return task;
+    }
+};
+
+//优先级队列
+//最小堆模式
+//
+class PriorityStrategy: public SchedulingStrategy{
+    struct TaskComparator{
+        bool operator() (const std::unique_ptr<Task>& a,
+                            const std::unique_ptr<Task>& b)
+        {
+            return a->getPriority() > b->getPriority(); //最小堆
+        }
+    };
+    std::priority_queue<
+        std::unique_ptr<Task>,
+        std::vector<std::unique_ptr<Task>>,
+        TaskComparator> pq_;
+
+public:
+    void addTask(std::unique_ptr<Task> task) override{
+        pq_.push(std::move(task));
+    }
+    std::unique_ptr<Task> getNextTask() override{
+        if (pq_.empty()) return nullptr;
+        auto task = std::move(const_cast<std::unique_ptr<Task>&>(pq_.top()));
+        pq_.pop();
+        return task;
+    }
+};
+
+//无锁有界MPMC先进先出策略
+//FifoStrategy包的是std::queue（deque底座，节点分配，完全不线程安全），
+//多线程调度器用它就得在每次submit/pop外面套一把全局锁
+//这里是Vyukov风格的有界环：
+//    每个槽位一个sequence号，入队出队各自CAS自己的游标
+//    两个游标各占一条cache line，生产者和消费者不互相伪共享
+//    isThreadSafe()==true，线程池直接并发调用，没有全局锁
+//容量固定（构造时给，向上取2的幂）：
+//    队列满时tryAddTask()返回false（背压信号），
+//    虚接口addTask()没法返回结果，满时原地退让重试
+class MpmcFifoStrategy: public SchedulingStrategy{
+private:
+    struct Cell{
+        std::atomic<std::size_t> seq;
+        Task *task;
+    };
+
+    std::vector<Cell> cells_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> enqueuePos_{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos_{0};
+
+    static std::size_t roundUpPow2(std::size_t n){
+        std::size_t c = 1;
+        while (c < n) c <<= 1;
+        return c;
+    }
+
+public:
+    explicit MpmcFifoStrategy(std::size_t capacity = 4096)
+        : cells_(roundUpPow2(capacity)), mask_(cells_.size() - 1)
+    {
+        for (std::size_t i = 0; i < cells_.size(); ++i){
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcFifoStrategy() override{
+        while (auto task = getNextTask()){ /* unique_ptr析构 */ }
+    }
+
+    bool isThreadSafe() const override { return true; }
+
+    //非阻塞入队：队列满返回false，任务还留在调用方手里
+    bool tryAddTask(std::unique_ptr<Task> &task){
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;){
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t dif = static_cast<std::intptr_t>(seq) -
+                                static_cast<std::intptr_t>(pos);
+            if (dif == 0){
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed)){
+                    break;
+                }
+            }else if (dif < 0){
+                return false;   //满
+            }else{
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->task = task.release();
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //虚接口：满时原地退让等消费者腾出位置（背压）
+    void addTask(std::unique_ptr<Task> task) override{
+        while (!tryAddTask(task)){
+            std::this_thread::yield();
+        }
+    }
+
+    std::unique_ptr<Task> getNextTask() override{
+        std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;){
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t dif = static_cast<std::intptr_t>(seq) -
+                                static_cast<std::intptr_t>(pos + 1);
+            if (dif == 0){
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed)){
+                    break;
+                }
+            }else if (dif < 0){
+                return nullptr;   //空
+            }else{
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        Task *task = cell->task;
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return std::unique_ptr<Task>(task);
+    }
+};
+
+//公平份额策略（把头部注释里承诺的“轮转调度”真正做出来）
+//严格优先级在多租户场景下会把低优先级租户饿死，
+//这里每个租户/类一个FIFO环形缓冲，按权重做亏空轮转（DRR）：
+//    权重4的类每轮连续出4个任务，权重1的出1个，谁都不会饿死
+//非空类的集合维护在一个64位掩码里，
+//getNextTask()选类就是一次countr_zero（tzcnt）加一次数组读，O(1)
+//最多64个类
+class FairShareStrategy: public SchedulingStrategy{
+public:
+    //把任务映射到类的函数；默认用getPriority()当类号
+    using Classifier = std::size_t (*)(const Task&);
+
+private:
+    //每类一个环形缓冲（容量2的幂，满了翻倍）
+    struct ClassRing{
+        std::vector<std::unique_ptr<Task>> ring;
+        std::size_t head = 0;
+        std::size_t tail = 0;
+        std::uint32_t weight = 1;
+
+        bool empty() const { return head == tail; }
+
+        void push(std::unique_ptr<Task> task){
+            if (ring.empty()) ring.resize(64);
+            if (tail - head == ring.size()) grow();
+            ring[tail & (ring.size() - 1)] = std::move(task);
+            ++tail;
+        }
+
+        std::unique_ptr<Task> pop(){
+            auto task = std::move(ring[head & (ring.size() - 1)]);
+            ++head;
+            return task;
+        }
+
+        void grow(){
+            std::vector<std::unique_ptr<Task>> bigger(ring.size() * 2);
+            std::size_t n = tail - head;
+            for (std::size_t i = 0; i < n; ++i){
+                bigger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+            }
+            ring = std::move(bigger);
+            head = 0;
+            tail = n;
+        }
+    };
+
+    std::vector<ClassRing> classes_;
+    std::uint64_t nonEmpty_ = 0;      //第i位=1表示第i类有任务
+    std::size_t cursor_ = 0;          //轮转到的类
+    std::uint32_t served_ = 0;        //当前类这一轮已经出了几个
+    Classifier classify_;
+
+    static std::size_t byPriority(const Task &t){
+        int p = t.getPriority();
+        return p < 0 ? 0 : static_cast<std::size_t>(p);
+    }
+
+    //从cursor_开始找下一个非空类（掩码旋转 + tzcnt）
+    std::size_t nextClass() const {
+        std::uint64_t ahead = nonEmpty_ & (~std::uint64_t{0} << cursor_);
+        return static_cast<std::size_t>(
+            std::countr_zero(ahead ? ahead : nonEmpty_));
+    }
+
+public:
+    //weights[i]是第i类每轮的份额，类数最多64
+    explicit FairShareStrategy(std::vector<std::uint32_t> weights,
+                               Classifier classify = byPriority)
+        : classes_(weights.size()), classify_(classify)
+    {
+        for (std::size_t i = 0; i < weights.size(); ++i){
+            classes_[i].weight = weights[i] ? weights[i] : 1;
+        }
+    }
+
+    void addTask(std::unique_ptr<Task> task) override{
+        std::size_t c = classify_(*task);
+        if (c >= classes_.size()) c = classes_.size() - 1;   //越界归到最后一类
+        classes_[c].push(std::move(task));
+        nonEmpty_ |= std::uint64_t{1} << c;
+    }
+
+    std::unique_ptr<Task> getNextTask() override{
+        if (nonEmpty_ == 0) return nullptr;
+
+        std::size_t c = nextClass();
+        if (c != cursor_){
+            cursor_ = c;
+            served_ = 0;
+        }
+
+        auto task = classes_[c].pop();
+        if (classes_[c].empty()){
+            nonEmpty_ &= ~(std::uint64_t{1} << c);
+        }
+
+        //份额用完就把游标转到下一个类
+        if (++served_ >= classes_[c].weight){
+            cursor_ = (c + 1) % classes_.size();
+            served_ = 0;
+        }
+        return task;
+    }
+};
+
+//4叉堆优先级策略
+//PriorityStrategy的问题：
+//    堆里存的是unique_ptr<Task>，每次比较都要追一次指针，
+//    再做一次虚调用getPriority() —— sift一趟全是cache miss
+//    getNextTask()还得用const_cast从priority_queue的top()里搬东西
+//这里改成(priority, Task*)成对连续存放的4叉最小堆：
+//    优先级在插入时取一次，之后比较就是读热数组里的int
+//    4叉堆深度是二叉堆的一半，一个节点的4个孩子挨在一起，
+//    sift摸到的cache line更少
+//    出队是正经的extract操作
+class DaryHeapStrategy: public SchedulingStrategy{
+private:
+    struct Entry{
+        int priority;
+        Task *task;
+    };
+
+    static constexpr std::size_t kArity = 4;
+    std::vector<Entry> heap_;
+
+    void siftUp(std::size_t i){
+        Entry e = heap_[i];
+        while (i > 0){
+            std::size_t parent = (i - 1) / kArity;
+            if (heap_[parent].priority <= e.priority) break;
+            heap_[i] = heap_[parent];
+            i = parent;
+        }
+        heap_[i] = e;
+    }
+
+    void siftDown(std::size_t i){
+        Entry e = heap_[i];
+        std::size_t n = heap_.size();
+        for (;;){
+            std::size_t first = i * kArity + 1;
+            if (first >= n) break;
+            //在最多4个孩子里挑最小的：都在连续内存里
+            std::size_t best = first;
+            std::size_t last = first + kArity < n ? first + kArity : n;
+            for (std::size_t c = first + 1; c < last; ++c){
+                if (heap_[c].priority < heap_[best].priority) best = c;
+            }
+            if (heap_[best].priority >= e.priority) break;
+            heap_[i] = heap_[best];
+            i = best;
+        }
+        heap_[i] = e;
+    }
+
+public:
+    ~DaryHeapStrategy() override{
+        for (auto &e : heap_) delete e.task;
+    }
+
+    void addTask(std::unique_ptr<Task> task) override{
+        //虚调用只在插入时做一次，sift过程不再碰Task对象
+        int priority = task->getPriority();
+        heap_.push_back({priority, task.release()});
+        siftUp(heap_.size() - 1);
+    }
+
+    std::unique_ptr<Task> getNextTask() override{
+        if (heap_.empty()) return nullptr;
+        Task *top = heap_.front().task;
+        heap_.front() = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) siftDown(0);
+        return std::unique_ptr<Task>(top);
+    }
+};
+
+//工作窃取策略
+//fork-join型负载（任务里再提交子任务）下，
+//一把全局锁的FIFO队列会让所有工作线程在一个mutex上排队
+//这里每个工作线程一个Chase-Lev双端队列：
+//    自己从底部LIFO地push/pop（刚提交的子任务数据还热着）
+//    没活干的线程从别人队列的顶部随机偷（FIFO端，冲突最小）
+//非工作线程提交的任务走一个带锁的注入队列
+class WorkStealingStrategy: public SchedulingStrategy{
+private:
+    //Chase-Lev双端队列，存裸Task指针（所有权在队列里）
+    //固定容量，满了返回false由上层放进注入队列
+    class WorkStealingDeque{
+    private:
+        alignas(64) std::atomic<std::int64_t> top_{0};
+        alignas(64) std::atomic<std::int64_t> bottom_{0};
+        std::vector<std::atomic<Task*>> buffer_;
+        std::size_t mask_;
+
+    public:
+        explicit WorkStealingDeque(std::size_t capacity)
+            : buffer_(capacity), mask_(capacity - 1){}
+
+        //owner线程：底部压入
+        bool push(Task *task){
+            std::int64_t b = bottom_.load(std::memory_order_relaxed);
+            std::int64_t t = top_.load(std::memory_order_acquire);
+            if (b - t >= static_cast<std::int64_t>(buffer_.size())) return false;
+            buffer_[b & mask_].store(task, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        //owner线程：底部弹出（LIFO）
+        Task *pop(){
+            std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top_.load(std::memory_order_relaxed);
+            Task *task = nullptr;
+            if (t <= b){
+                task = buffer_[b & mask_].load(std::memory_order_relaxed);
+                if (t == b){
+                    //最后一个元素，和窃取者赛跑
+                    if (!top_.compare_exchange_strong(t, t + 1,
+                            std::memory_order_seq_cst,
+                            std::memory_order_relaxed)){
+                        task = nullptr;   //输给窃取者了
+                    }
+                    bottom_.store(b + 1, std::memory_order_relaxed);
+                }
+            }else{
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        //其他线程：顶部窃取（FIFO）
+        Task *steal(){
+            std::int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) return nullptr;
+            Task *task = buffer_[t & mask_].load(std::memory_order_relaxed);
+            if (!top_.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst,
+                    std::memory_order_relaxed)){
+                return nullptr;   //被别的窃取者抢先
+            }
+            return task;
+        }
+    };
+
+    struct Worker{
+        WorkStealingDeque deque;
+        explicit Worker(std::size_t capacity): deque(capacity){}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::size_t> registered_{0};
+
+    //注入队列：非worker线程提交、或者本地deque满了用
+    std::mutex injectMtx_;
+    std::queue<Task*> inject_;
+
+    //线程在本实例里的worker下标缓存（第一次用到时懒注册）
+    //注意thread_local是按线程缓存一个实例的下标，
+    //一个线程同时用多个WorkStealingStrategy实例时只有最近的走本地deque
+    inline static thread_local const WorkStealingStrategy *tlsOwner = nullptr;
+    inline static thread_local std::size_t tlsIndex = 0;
+
+    Worker *localWorker(){
+        if (tlsOwner == this) return workers_[tlsIndex].get();
+        std::size_t idx = registered_.fetch_add(1);
+        if (idx >= workers_.size()){
+            registered_.fetch_sub(1);
+            return nullptr;   //worker槽位用完，走注入队列
+        }
+        tlsOwner = this;
+        tlsIndex = idx;
+        return workers_[idx].get();
+    }
+
+    Task *popInject(){
+        std::lock_guard<std::mutex> lock(injectMtx_);
+        if (inject_.empty()) return nullptr;
+        Task *task = inject_.front();
+        inject_.pop();
+        return task;
+    }
+
+    //从随机起点开始扫一圈别人的队列
+    Task *stealAny(const Worker *self){
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        std::size_t n = workers_.size();
+        std::size_t start = rng() % n;
+        for (std::size_t i = 0; i < n; ++i){
+            Worker *victim = workers_[(start + i) % n].get();
+            if (victim == self) continue;
+            if (Task *task = victim->deque.steal()) return task;
+        }
+        return nullptr;
+    }
+
+public:
+    explicit WorkStealingStrategy(std::size_t workerCount =
+                                      std::thread::hardware_concurrency(),
+                                  std::size_t dequeCapacity = 8192)
+    {
+        if (workerCount == 0) workerCount = 1;
+        //多留一个槽给提交任务的主线程
+        for (std::size_t i = 0; i < workerCount + 1; ++i){
+            workers_.push_back(std::make_unique<Worker>(dequeCapacity));
+        }
+    }
+
+    ~WorkStealingStrategy() override{
+        //回收还没执行的任务
+        while (auto task = getNextTask()){ /* unique_ptr析构 */ }
+    }
+
+    bool isThreadSafe() const override { return true; }
+
+    void addTask(std::unique_ptr<Task> task) override{
+        Task *raw = task.release();
+        if (Worker *w = localWorker()){
+            if (w->deque.push(raw)) return;
+        }
+        std::lock_guard<std::mutex> lock(injectMtx_);
+        inject_.push(raw);
+    }
+
+    std::unique_ptr<Task> getNextTask() override{
+        Worker *w = localWorker();
+        Task *raw = nullptr;
+        if (w) raw = w->deque.pop();          //先拿自己的（LIFO，缓存友好）
+        if (!raw) raw = popInject();          //再看注入队列
+        if (!raw) raw = stealAny(w);          //最后随机偷别人的
+        return std::unique_ptr<Task>(raw);
+    }
+
+    //批量提交：能进本地deque的直接进，放不下的整批一次锁进注入队列
+    void addTasks(std::vector<std::unique_ptr<Task>> tasks) override{
+        Worker *w = localWorker();
+        std::vector<Task*> overflow;
+        for (auto &t : tasks){
+            Task *raw = t.release();
+            if (w && w->deque.push(raw)) continue;
+            overflow.push_back(raw);
+        }
+        if (!overflow.empty()){
+            std::lock_guard<std::mutex> lock(injectMtx_);
+            for (Task *raw : overflow) inject_.push(raw);
+        }
+    }
+};
+
+//亲和包装任务：给没有亲和字段的任务外挂一个节点号
+//优先级透传给里面的任务
+class AffinityTask: public Task{
+    std::unique_ptr<Task> inner_;
+    int node_;
+public:
+    AffinityTask(std::unique_ptr<Task> inner, int node)
+        : inner_(std::move(inner)), node_(node) {}
+    void execute() override { inner_->execute(); }
+    int getPriority() const override { return inner_->getPriority(); }
+    int getAffinity() const override { return node_; }
+};
+
+//NUMA亲和策略
+//双路机器上node 0的数据被node 1的worker执行，访存延迟翻倍
+//这里每个NUMA节点一份独立的子策略实例：
+//    带亲和提示的任务进对应节点的队列，没提示的进提交线程的本地节点
+//    worker先消费本节点队列，空了才跨节点去拿（远端慢就慢在偶发路径上）
+//    每个节点一把自己的锁，节点之间提交/消费互不干扰
+//不依赖libnuma：节点数由构造参数给出，线程按注册顺序轮转归属到节点，
+//真上多路机器时由部署侧用numactl/pthread_setaffinity把worker钉到对应socket
+//单节点构造时行为退化成被包的子策略本身
+class NumaAwareStrategy: public SchedulingStrategy{
+private:
+    struct Node{
+        std::unique_ptr<SchedulingStrategy> strategy;
+        std::mutex mtx;   //子策略不一定线程安全，按节点加锁
+    };
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::atomic<std::size_t> registered_{0};
+
+    //线程归属的节点缓存（懒注册，轮转分配）
+    //和WorkStealingStrategy的tls缓存同样的限制：按线程记最近的实例
+    inline static thread_local const NumaAwareStrategy *tlsOwner = nullptr;
+    inline static thread_local std::size_t tlsNode = 0;
+
+    std::size_t localNode(){
+        if (tlsOwner == this) return tlsNode;
+        tlsOwner = this;
+        tlsNode = registered_.fetch_add(1) % nodes_.size();
+        return tlsNode;
+    }
+
+    std::size_t nodeFor(const Task &task){
+        int hint = task.getAffinity();
+        if (hint >= 0) return static_cast<std::size_t>(hint) % nodes_.size();
+        return localNode();
+    }
+
+public:
+    //每个节点一份子策略，节点数就是perNode.size()
+    explicit NumaAwareStrategy(
+        std::vector<std::unique_ptr<SchedulingStrategy>> perNode)
+    {
+        nodes_.reserve(perNode.size());
+        for (auto &s : perNode){
+            auto node = std::make_unique<Node>();
+            node->strategy = std::move(s);
+            nodes_.push_back(std::move(node));
+        }
+    }
+
+    bool isThreadSafe() const override { return true; }   //内部按节点加锁
+
+    void addTask(std::unique_ptr<Task> task) override{
+        Node &node = *nodes_[nodeFor(*task)];
+        std::lock_guard<std::mutex> lock(node.mtx);
+        node.strategy->addTask(std::move(task));
+    }
+
+    std::unique_ptr<Task> getNextTask() override{
+        std::size_t home = localNode();
+        std::size_t n = nodes_.size();
+        //先本节点，空了再从下一个节点开始跨节点找
+        for (std::size_t i = 0; i < n; ++i){
+            Node &node = *nodes_[(home + i) % n];
+            std::lock_guard<std::mutex> lock(node.mtx);
+            if (auto task = node.strategy->getNextTask()) return task;
+        }
+        return nullptr;
+    }
+
+    std::size_t getNextTasks(std::span<std::unique_ptr<Task>> out) override{
+        std::size_t home = localNode();
+        std::size_t n = nodes_.size();
+        for (std::size_t i = 0; i < n; ++i){
+            Node &node = *nodes_[(home + i) % n];
+            std::lock_guard<std::mutex> lock(node.mtx);
+            std::size_t got = node.strategy->getNextTasks(out);
+            if (got > 0) return got;
+        }
+        return 0;
+    }
+};
+
+//任务对象池
+//确实需要多态Task层次的任务（PrintTask/PriorityTask这类），
+//突发提交下30%+的CPU会耗在malloc/free里，长时间跑还有堆碎片
+//这里做成slab池：
+//    整块申请1024个固定大小槽位，用完再挂一块新slab
+//    释放的槽位进自由链表，之后的创建/销毁就是指针换向
+//    槽位从不归还给堆，一周长跑也不会把堆搅碎
+class TaskPool{
+public:
+    //槽位大小：FnTask（带48字节内联捕获）和各种小任务都放得下，
+    //放不下的编译期报错
+    static constexpr std::size_t kSlotSize = 128;
+
+private:
+    static constexpr std::size_t kSlotsPerSlab = 1024;
+
+    union Slot{
+        Slot *next;
+        alignas(std::max_align_t) unsigned char storage[kSlotSize];
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> slabs_;
+    Slot *freeList_ = nullptr;
+    std::mutex mtx_;   //池操作就几条指令，锁的代价远小于malloc
+
+    void newSlab(){
+        auto slab = std::make_unique<Slot[]>(kSlotsPerSlab);
+        for (std::size_t i = 0; i < kSlotsPerSlab; ++i){
+            slab[i].next = freeList_;
+            freeList_ = &slab[i];
+        }
+        slabs_.push_back(std::move(slab));
+    }
+
+public:
+    void *allocate(){
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!freeList_) newSlab();
+        Slot *s = freeList_;
+        freeList_ = s->next;
+        return s;
+    }
+
+    void deallocate(void *p){
+        std::lock_guard<std::mutex> lock(mtx_);
+        Slot *s = static_cast<Slot*>(p);
+        s->next = freeList_;
+        freeList_ = s;
+    }
+};
+
+//池化任务：T的槽位来自TaskPool
+//用C++20的destroying delete：通过Task*删除时，
+//先从对象里拿到池指针，析构后把槽位还回池，全程不碰堆
+//这样池化任务可以照常放进unique_ptr<Task>的策略队列
+template <typename T>
+class PooledTask final: public T{
+    TaskPool *pool_;
+
+public:
+    template <typename... Args>
+    explicit PooledTask(TaskPool *pool, Args&&... args)
+        : T(std::forward<Args>(args)...), pool_(pool) {}
+
+    void operator delete(PooledTask *p, std::destroying_delete_t){
+        TaskPool *pool = p->pool_;
+        p->~PooledTask();
+        pool->deallocate(p);
+    }
+
+    //配对的常规operator delete（构造抛异常时的回退路径不走池）
+    void operator delete(void*){}
+};
+
+//从池里造一个任务
+template <typename T, typename... Args>
+std::unique_ptr<Task> makePooledTask(TaskPool &pool, Args&&... args){
+    static_assert(sizeof(PooledTask<T>) <= TaskPool::kSlotSize,
+                  "任务太大，放不进TaskPool的槽位");
+    void *mem = pool.allocate();
+    return std::unique_ptr<Task>(
+        new (mem) PooledTask<T>(&pool, std::forward<Args>(args)...));
+}
+
+//调度统计
+//调度器不该是黑盒：队列深度、任务等待时间、执行时间都要能看到
+//设计成常开低开销：
+//    提交/完成是relaxed原子自增
+//    延迟直方图是HDR风格的对数桶（第i桶统计[2^i, 2^(i+1))ns），
+//    只对1-in-N采样的任务打时间戳
+//稳态下每个任务的成本就是两三次relaxed自增
+//snapshot()拷一份当前值，给指标管道定期来刮
+class SchedulerStats{
+public:
+    static constexpr std::size_t kBuckets = 64;
+
+    struct Snapshot{
+        std::uint64_t submitted = 0;
+        std::uint64_t executed = 0;
+        std::uint64_t queueDepth = 0;
+        std::array<std::uint64_t, kBuckets> waitBuckets{};   //提交->开始执行
+        std::array<std::uint64_t, kBuckets> execBuckets{};   //执行耗时
+
+        //从对数桶估算分位数（取桶的几何中点），单位ns
+        static std::uint64_t percentile(
+            const std::array<std::uint64_t, kBuckets> &buckets, double q){
+            std::uint64_t total = 0;
+            for (auto b : buckets) total += b;
+            if (total == 0) return 0;
+            std::uint64_t rank = static_cast<std::uint64_t>(total * q);
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBuckets; ++i){
+                seen += buckets[i];
+                if (seen > rank){
+                    return (std::uint64_t{1} << i) +
+                           (std::uint64_t{1} << i) / 2;
+                }
+            }
+            return std::uint64_t{1} << (kBuckets - 1);
+        }
+
+        std::uint64_t waitNs(double q) const { return percentile(waitBuckets, q); }
+        std::uint64_t execNs(double q) const { return percentile(execBuckets, q); }
+    };
+
+private:
+    std::atomic<std::uint64_t> submitted_{0};
+    std::atomic<std::uint64_t> executed_{0};
+    std::array<std::atomic<std::uint64_t>, kBuckets> wait_{};
+    std::array<std::atomic<std::uint64_t>, kBuckets> exec_{};
+    std::uint64_t sampleEvery_;
+    std::atomic<std::uint64_t> ticket_{0};
+
+    static std::size_t bucketOf(std::uint64_t ns){
+        return static_cast<std::size_t>(std::bit_width(ns | 1) - 1);
+    }
+
+public:
+    //sampleEvery=N：每N个任务有1个带时间戳
+    explicit SchedulerStats(std::uint64_t sampleEvery = 64)
+        : sampleEvery_(sampleEvery ? sampleEvery : 1) {}
+
+    void onSubmit(std::uint64_t n = 1){ submitted_.fetch_add(n, std::memory_order_relaxed); }
+    void onExecuted(){ executed_.fetch_add(1, std::memory_order_relaxed); }
+
+    bool shouldSample(){
+        return ticket_.fetch_add(1, std::memory_order_relaxed) % sampleEvery_ == 0;
+    }
+
+    void recordWait(std::uint64_t ns){
+        wait_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+    void recordExec(std::uint64_t ns){
+        exec_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Snapshot snapshot(std::uint64_t queueDepth) const {
+        Snapshot s;
+        s.submitted = submitted_.load(std::memory_order_relaxed);
+        s.executed = executed_.load(std::memory_order_relaxed);
+        s.queueDepth = queueDepth;
+        for (std::size_t i = 0; i < kBuckets; ++i){
+            s.waitBuckets[i] = wait_[i].load(std::memory_order_relaxed);
+            s.execBuckets[i] = exec_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+};
+
+//被采样任务的包装：记下提交时刻，执行时算出等待和耗时
+class TimedTask: public Task{
+    std::unique_ptr<Task> inner_;
+    SchedulerStats *stats_;
+    std::chrono::steady_clock::time_point submitted_;
+
+public:
+    TimedTask(std::unique_ptr<Task> inner, SchedulerStats *stats)
+        : inner_(std::move(inner)), stats_(stats),
+          submitted_(std::chrono::steady_clock::now()) {}
+
+    void execute() override{
+        auto start = std::chrono::steady_clock::now();
+        stats_->recordWait(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                start - submitted_).count()));
+        inner_->execute();
+        auto end = std::chrono::steady_clock::now();
+        stats_->recordExec(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                end - start).count()));
+    }
+
+    int getPriority() const override{ return inner_->getPriority(); }
+    int getAffinity() const override{ return inner_->getAffinity(); }
+};
+
+//分层时间轮
+//重试/超时类任务几十万个，用按时间排序的priority_queue每个定时器都是O(log n)
+//时间轮把到期tick散列进槽位：插入和每tick的推进都是O(1)均摊
+//4层 x 64槽，1个tick是1ms的话能覆盖约19小时
+//到期的任务被倒进普通任务队列，走原有的getNextTask()路径
+//本身不加锁，由持有它的调度器在自己的锁里驱动
+class TimerWheel{
+public:
+    static constexpr std::size_t kSlotBits = 6;
+    static constexpr std::size_t kSlots = 64;
+    static constexpr std::size_t kLevels = 4;
+
+private:
+    struct Pending{
+        std::unique_ptr<Task> task;
+        std::uint64_t expire;   //到期的tick号
+    };
+
+    std::vector<Pending> slots_[kLevels][kSlots];
+    std::uint64_t current_ = 0;
+
+    static std::size_t levelOf(std::uint64_t delta){
+        for (std::size_t l = 0; l < kLevels - 1; ++l){
+            if (delta < (std::uint64_t{1} << (kSlotBits * (l + 1)))) return l;
+        }
+        return kLevels - 1;
+    }
+
+    //把定时器挂到对应层的槽里；高层的会在级联时往下沉
+    void place(Pending p){
+        std::uint64_t delta = p.expire > current_ ? p.expire - current_ : 0;
+        std::size_t l = levelOf(delta);
+        std::size_t idx = (p.expire >> (kSlotBits * l)) & (kSlots - 1);
+        slots_[l][idx].push_back(std::move(p));
+    }
+
+public:
+    //delayTicks个tick之后到期（0当作1处理）
+    void add(std::unique_ptr<Task> task, std::uint64_t delayTicks){
+        if (delayTicks == 0) delayTicks = 1;
+        place({std::move(task), current_ + delayTicks});
+    }
+
+    //推进一个tick，到期的任务追加进out
+    void tick(std::vector<std::unique_ptr<Task>> &out){
+        ++current_;
+        //走到高层槽边界时级联：把那一槽的定时器按剩余时间重新下放
+        for (std::size_t l = 1; l < kLevels; ++l){
+            if ((current_ & ((std::uint64_t{1} << (kSlotBits * l)) - 1)) != 0) break;
+            std::size_t idx = (current_ >> (kSlotBits * l)) & (kSlots - 1);
+            auto timers = std::move(slots_[l][idx]);
+            slots_[l][idx].clear();
+            for (auto &t : timers) place(std::move(t));
+        }
+        //本tick到期的都在第0层的这个槽里
+        auto &cell = slots_[0][current_ & (kSlots - 1)];
+        for (auto &t : cell) out.push_back(std::move(t.task));
+        cell.clear();
+    }
+};
+
+//调度器
+//需要一个策略进行初始化
+class Scheduler{
+    TaskPool pool_;   //本调度器自己的任务对象池（放在策略前面：策略析构时可能还持有池化任务）
+    std::unique_ptr<SchedulingStrategy> strategy_;
+public:
+    explicit Scheduler(std::unique_ptr<SchedulingStrategy> strategy)
+        : strategy_(std::move(strategy)) {}
+
+    //从池里创建任务：scheduler.make_task<PrintTask>("msg")
+    //销毁时槽位自动回池
+    template <typename T, typename... Args>
+    std::unique_ptr<Task> make_task(Args&&... args){
+        return makePooledTask<T>(pool_, std::forward<Args>(args)...);
+    }
+
+    void submit(std::unique_ptr<Task> task){
+        strategy_->addTask(std::move(task));
+    }
+
+    //热路径重载：lambda不经过std::function，直接住进TaskFn的内联存储
+    //FnTask节点从池里拿，不走malloc
+    void submit(TaskFn fn){
+        strategy_->addTask(makePooledTask<FnTask>(pool_, std::move(fn)));
+    }
+
+    //整批提交，一次虚调用
+    void submitBatch(std::vector<std::unique_ptr<Task>> tasks){
+        strategy_->addTasks(std::move(tasks));
+    }
+
+    void run(){
+        while(auto task = strategy_->getNextTask()){
+            task->execute();
+        }
+    }
+};
+
+//协程任务
+//Task::execute()模型下，任务一阻塞就把工作线程钉死了
+//协程任务在等待点挂起，把恢复动作重新排进策略队列，
+//几千个在途的逻辑任务复用几个工作线程：
+//并发量从线程数瓶颈变成内存瓶颈
+//
+//用法：
+//    CoTask pipeline(ThreadPoolScheduler &pool){
+//        ...第一阶段...
+//        co_await pool.yield();        //挂起，重新排队，别的任务先跑
+//        ...第二阶段...
+//        co_await resumeOn(otherPool); //下一段换到另一个调度器上跑
+//        ...
+//    }
+//    pool.submit(pipeline(pool));
+class CoTask{
+public:
+    struct promise_type{
+        CoTask get_return_object(){
+            return CoTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        //提交给调度器之后才开始执行
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        //跑完自动销毁协程帧
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void(){}
+        void unhandled_exception(){ std::terminate(); }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit CoTask(Handle h): handle_(h){}
+    CoTask(CoTask &&other) noexcept: handle_(other.handle_){ other.handle_ = nullptr; }
+    CoTask(const CoTask&) = delete;
+    CoTask &operator=(const CoTask&) = delete;
+    CoTask &operator=(CoTask&&) = delete;
+    ~CoTask(){ if (handle_) handle_.destroy(); }
+
+    //所有权交给调度器
+    Handle release(){
+        Handle h = handle_;
+        handle_ = nullptr;
+        return h;
+    }
+
+private:
+    Handle handle_;
+};
+
+//任务依赖DAG的节点
+//以前“B必须在A之后”只能分阶段跑run()，阶段边界上所有核等最慢的那个
+//现在每个节点带一个原子的未完成前置计数：
+//    前置任务完成时把计数减1，减到0的节点直接进策略队列
+//    没有阶段屏障，后继任务在最后一个前置完成的瞬间就绪
+//环不做检测，由调用方保证是DAG（有环的话相关任务永远不会就绪）
+struct DagNode{
+    std::unique_ptr<Task> task;
+    std::atomic<int> pending{1};   //多出的1是提交方的守卫，注册完才放行
+    bool done = false;             //由mtx保护
+    std::mutex mtx;                //保护done和dependents
+    std::vector<std::shared_ptr<DagNode>> dependents;
+};
+
+class ThreadPoolScheduler;
+
+//挂起当前协程，把恢复动作排进pool的策略队列
+struct ScheduleOnAwaiter{
+    ThreadPoolScheduler *pool;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);   //定义在ThreadPoolScheduler之后
+    void await_resume() const noexcept {}
+};
+
+//结果/续延通道的共享状态
+//任务的输出以前只有副作用一条路，std::future每个状态一次堆分配，
+//还背着mutex/condvar；流水线一个请求5~10级，每级都付一遍受不了
+//这里：
+//    状态槽位来自TaskPool（128字节），用完回池，不碰堆
+//    续延是一个TaskFn，住在状态里的内联槽
+//    一个位标志atomic协调“值到了”和“续延挂上了”：
+//    fetch_or置自己的位，看到对方的位已经在了就由自己负责
+//    把续延排进策略队列——没有锁，没有condvar，触发恰好一次
+//引用计数固定从2开始：生产者一份，消费端（句柄或续延）一份
+template <typename T>
+class ResultState{
+private:
+    static constexpr int kHasValue = 1;
+    static constexpr int kHasCont = 2;
+
+    alignas(T) unsigned char value_[sizeof(T)];
+    TaskFn cont_;
+    std::atomic<int> bits_{0};
+    std::atomic<int> refs_{2};
+    ThreadPoolScheduler *sched_;
+    TaskPool *pool_;
+
+public:
+    ResultState(ThreadPoolScheduler *sched, TaskPool *pool)
+        : sched_(sched), pool_(pool) {}
+
+    ThreadPoolScheduler *scheduler() const { return sched_; }
+    TaskPool *pool() const { return pool_; }
+
+    bool ready() const {
+        return bits_.load(std::memory_order_acquire) & kHasValue;
+    }
+
+    T &value(){ return *reinterpret_cast<T*>(value_); }
+
+    //生产者：放值。续延已经挂上的话由这边负责把它排进队列
+    void setValue(T v);              //定义在ThreadPoolScheduler之后
+
+    //消费端：挂续延。值已经到了的话由这边负责排队
+    void setContinuation(TaskFn fn); //同上
+
+    //放掉一份引用，最后一个负责析构并把槽位还回池
+    void release(){
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            if (bits_.load(std::memory_order_relaxed) & kHasValue){
+                value().~T();
+            }
+            TaskPool *pool = pool_;
+            this->~ResultState();
+            pool->deallocate(this);
+        }
+    }
+};
+
+//结果句柄：一根指针大小，move-only
+//流水线的正道是then()；get()是自旋等待，只给演示和收尾用
+template <typename T>
+class ResultHandle{
+private:
+    ResultState<T> *state_ = nullptr;
+
+public:
+    ResultHandle() = default;
+    explicit ResultHandle(ResultState<T> *state): state_(state) {}
+
+    ResultHandle(ResultHandle &&other) noexcept
+        : state_(other.state_) { other.state_ = nullptr; }
+    ResultHandle &operator=(ResultHandle &&other) noexcept{
+        if (this != &other){
+            if (state_) state_->release();
+            state_ = other.state_;
+            other.state_ = nullptr;
+        }
+        return *this;
+    }
+    ResultHandle(const ResultHandle &) = delete;
+    ResultHandle &operator=(const ResultHandle &) = delete;
+
+    ~ResultHandle(){ if (state_) state_->release(); }
+
+    bool valid() const { return state_ != nullptr; }
+    bool ready() const { return state_ && state_->ready(); }
+
+    //挂续延，句柄随之失效（引用转移给续延）
+    //fn返回值的话给下一级一个新句柄，整条链不碰堆
+    template <typename F>
+    auto then(F fn){
+        using U = std::invoke_result_t<F, T>;
+        ResultState<T> *state = state_;
+        state_ = nullptr;
+        if constexpr (std::is_void_v<U>){
+            state->setContinuation(TaskFn([state, fn]{
+                fn(std::move(state->value()));
+                state->release();
+            }));
+        }else{
+            static_assert(sizeof(ResultState<U>) <= TaskPool::kSlotSize);
+            auto *next = new (state->pool()->allocate())
+                ResultState<U>(state->scheduler(), state->pool());
+            state->setContinuation(TaskFn([state, next, fn]{
+                next->setValue(fn(std::move(state->value())));
+                state->release();
+                next->release();   //下一级的生产者引用
+            }));
+            return ResultHandle<U>(next);
+        }
+    }
+
+    //自旋等到值就绪并取走
+    T get(){
+        while (!state_->ready()){
+            std::this_thread::yield();
+        }
+        T v = std::move(state_->value());
+        state_->release();
+        state_ = nullptr;
+        return v;
+    }
+};
+
+//线程池调度器
+//Scheduler::run()在调用线程上串行执行，10万个任务也只能用一个核
+//这里用N个工作线程消费同一个策略队列：
+//    普通策略不是线程安全的，对它的访问统一在strategyMtx_里，
+//    出队顺序仍然完全由策略决定
+//    线程安全的策略（isThreadSafe()，如工作窃取）直接并发调用，没有全局锁
+//    执行永远在锁外进行
+//提交之后任务就异步地跑起来了，wait()等所有在途任务完成（graceful drain），
+//shutdown()排空队列后停线程（析构时自动做）
+class ThreadPoolScheduler{
+    TaskPool pool_;                      //任务对象池（放在策略前面，策略析构时可能还持有池化任务）
+    SchedulerStats stats_;               //常开统计（同样要活得比策略久）
+    std::unique_ptr<SchedulingStrategy> strategy_;
+    bool lockStrategy_;                  //策略不线程安全时为true
+    std::size_t threadCount_ = 1;
+    std::vector<std::thread> workers_;
+
+    std::mutex strategyMtx_;             //只保护策略本身
+    std::mutex cvMtx_;                   //只用于条件变量的睡眠/唤醒
+    std::condition_variable hasWork_;    //唤醒工作线程
+    std::condition_variable allDone_;    //唤醒wait()
+    std::atomic<std::size_t> queued_{0};    //队列里的任务数
+    std::atomic<std::size_t> running_{0};   //正在执行的任务数
+    std::atomic<bool> stopping_{false};
+
+    //延迟任务：时间轮 + 按需启动的定时线程
+    static constexpr std::chrono::milliseconds kTick{1};
+    TimerWheel wheel_;
+    std::mutex wheelMtx_;
+    std::thread timerThread_;
+    std::atomic<bool> timerRunning_{false};
+
+    void ensureTimerThread(){
+        if (timerRunning_.exchange(true)) return;
+        timerThread_ = std::thread([this]{ timerLoop(); });
+    }
+
+    void timerLoop(){
+        std::vector<std::unique_ptr<Task>> expired;
+        auto next = std::chrono::steady_clock::now() + kTick;
+        while (!stopping_.load()){
+            std::this_thread::sleep_until(next);
+            //睡过头的话把欠的tick都补上
+            auto now = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(wheelMtx_);
+                while (next <= now){
+                    wheel_.tick(expired);
+                    next += kTick;
+                }
+            }
+            //到期任务进普通队列，和即时任务走同一条执行路径
+            for (auto &t : expired){
+                submit(std::move(t));
+            }
+            expired.clear();
+        }
+    }
+
+    //一次锁往返最多取走一块任务
+    //按当前队列深度分摊：队列浅的时候每次只拿一个，不会有线程囤积任务
+    std::size_t takeBatch(std::span<std::unique_ptr<Task>> out){
+        std::size_t want = queued_.load() / threadCount_ + 1;
+        if (want > out.size()) want = out.size();
+        auto slice = out.first(want);
+        if (lockStrategy_){
+            std::lock_guard<std::mutex> lock(strategyMtx_);
+            return strategy_->getNextTasks(slice);
+        }
+        return strategy_->getNextTasks(slice);
+    }
+
+    void put(std::unique_ptr<Task> task){
+        if (lockStrategy_){
+            std::lock_guard<std::mutex> lock(strategyMtx_);
+            strategy_->addTask(std::move(task));
+            return;
+        }
+        strategy_->addTask(std::move(task));
+    }
+
+    //工作线程一次取走的任务块大小：
+    //队列深的时候一次锁往返搬一块，而不是一个
+    static constexpr std::size_t kDrainBatch = 16;
+
+    void workerLoop(){
+        std::array<std::unique_ptr<Task>, kDrainBatch> batch;
+        for (;;){
+            {
+                std::unique_lock<std::mutex> lock(cvMtx_);
+                hasWork_.wait(lock, [this]{
+                    return queued_.load() > 0 || stopping_.load();
+                });
+            }
+            if (queued_.load() == 0 && stopping_.load()) return;
+
+            std::size_t n = takeBatch(batch);
+            if (n == 0) continue;   //被别的线程抢走了，重新等
+
+            //先标记在跑再减queued_，避免wait()看到两个都是0的空档
+            running_.fetch_add(n);
+            queued_.fetch_sub(n);
+
+            //执行不占锁
+            for (std::size_t i = 0; i < n; ++i){
+                batch[i]->execute();
+                batch[i].reset();
+                stats_.onExecuted();
+            }
+
+            if (running_.fetch_sub(n) == n && queued_.load() == 0){
+                std::lock_guard<std::mutex> lock(cvMtx_);
+                allDone_.notify_all();
+            }
+        }
+    }
+
+    //DAG节点就绪：包一层TaskFn进队列，跑完之后给后继放行
+    //捕获是this + shared_ptr共24字节，住在TaskFn的内联存储里
+    void enqueueNode(std::shared_ptr<DagNode> node){
+        submit(TaskFn([this, node]{
+            node->task->execute();
+            node->task.reset();
+            //摘后继列表要拿锁：和正在注册新后继的submit互斥
+            std::vector<std::shared_ptr<DagNode>> ready;
+            {
+                std::lock_guard<std::mutex> lock(node->mtx);
+                node->done = true;
+                ready.swap(node->dependents);
+            }
+            for (auto &d : ready){
+                if (d->pending.fetch_sub(1) == 1) enqueueNode(d);
+            }
+        }));
+    }
+
+public:
+    ThreadPoolScheduler(std::unique_ptr<SchedulingStrategy> strategy,
+                        std::size_t threadCount = std::thread::hardware_concurrency())
+        : strategy_(std::move(strategy)),
+          lockStrategy_(!strategy_->isThreadSafe())
+    {
+        if (threadCount == 0) threadCount = 1;
+        threadCount_ = threadCount;
+        workers_.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i){
+            workers_.emplace_back([this]{ workerLoop(); });
+        }
+    }
+
+    ~ThreadPoolScheduler(){ shutdown(); }
+
+    //提交即异步执行
+    void submit(std::unique_ptr<Task> task){
+        stats_.onSubmit();
+        //1-in-N采样：被采中的任务包一层时间戳
+        if (stats_.shouldSample()){
+            task = makePooledTask<TimedTask>(pool_, std::move(task), &stats_);
+        }
+        //先加计数再入队：worker取任务时queued_只会偏大不会偏小，
+        //反过来的话worker可能取走计数还没加上的任务，
+        //queued_.fetch_sub下溢成天文数字，wait()再也等不到通知
+        queued_.fetch_add(1);
+        put(std::move(task));
+        {
+            std::lock_guard<std::mutex> lock(cvMtx_);
+        }
+        hasWork_.notify_one();
+    }
+
+    void submit(TaskFn fn){
+        //FnTask节点从池里拿，热路径彻底不走malloc
+        submit(makePooledTask<FnTask>(pool_, std::move(fn)));
+    }
+
+    template <typename T, typename... Args>
+    std::unique_ptr<Task> make_task(Args&&... args){
+        return makePooledTask<T>(pool_, std::forward<Args>(args)...);
+    }
+
+    //带亲和提示提交：任务进affinity号节点的队列
+    //只在策略是NumaAwareStrategy时有效果，别的策略无视提示
+    void submit(std::unique_ptr<Task> task, int affinity){
+        submit(makePooledTask<AffinityTask>(pool_, std::move(task), affinity));
+    }
+
+    void submit(TaskFn fn, int affinity){
+        submit(makePooledTask<AffinityTask>(
+            pool_, makePooledTask<FnTask>(pool_, std::move(fn)), affinity));
+    }
+
+    //提交有返回值的任务，拿一个轻量句柄
+    //共享状态住在任务池的槽位里，续延经then()挂上后
+    //重新进策略队列执行——整条链路没有堆分配
+    template <typename T, typename F>
+    ResultHandle<T> submitWithResult(F fn){
+        static_assert(sizeof(ResultState<T>) <= TaskPool::kSlotSize,
+                      "结果类型太大，放不进池槽位");
+        auto *state = new (pool_.allocate()) ResultState<T>(this, &pool_);
+        submit(TaskFn([state, fn]{
+            state->setValue(fn());
+            state->release();   //生产者的引用
+        }));
+        return ResultHandle<T>(state);
+    }
+
+    //提交一个协程任务：第一次resume排进队列
+    void submit(CoTask task){
+        CoTask::Handle h = task.release();
+        submit(TaskFn([h]{ h.resume(); }));
+    }
+
+    //协程里co_await pool.yield()：让出工作线程，重新排队
+    ScheduleOnAwaiter yield(){ return {this}; }
+
+    //带依赖提交：deps里的任务全部执行完，task才进策略队列
+    //返回的句柄可以继续当别人的依赖，已完成的依赖直接跳过
+    //最后一个前置完成的瞬间后继就绪，没有阶段屏障
+    using TaskHandle = std::shared_ptr<DagNode>;
+
+    TaskHandle submit(std::unique_ptr<Task> task,
+                      std::span<const TaskHandle> deps){
+        auto node = std::make_shared<DagNode>();
+        node->task = std::move(task);
+        for (const auto &dep : deps){
+            //在dep的锁里注册并加计数：保证dep完成时的fetch_sub
+            //一定发生在这次fetch_add之后，不会把计数减成负数
+            std::lock_guard<std::mutex> lock(dep->mtx);
+            if (!dep->done){
+                dep->dependents.push_back(node);
+                node->pending.fetch_add(1);
+            }
+        }
+        //放掉提交方守卫；前置都已完成的话就地入队
+        if (node->pending.fetch_sub(1) == 1) enqueueNode(node);
+        return node;
+    }
+
+    TaskHandle submit(TaskFn fn, std::span<const TaskHandle> deps){
+        return submit(makePooledTask<FnTask>(pool_, std::move(fn)), deps);
+    }
+
+    //方便直接写pool.submit(fn, {a, b})
+    TaskHandle submit(TaskFn fn, std::initializer_list<TaskHandle> deps){
+        return submit(makePooledTask<FnTask>(pool_, std::move(fn)),
+                      std::span<const TaskHandle>(deps.begin(), deps.size()));
+    }
+
+    //延迟提交：delay之后任务进队列
+    //粒度是1ms的tick；还没到期就shutdown的定时任务会被丢弃
+    void submitAfter(std::chrono::milliseconds delay,
+                     std::unique_ptr<Task> task){
+        ensureTimerThread();
+        std::uint64_t ticks = static_cast<std::uint64_t>(delay / kTick);
+        std::lock_guard<std::mutex> lock(wheelMtx_);
+        wheel_.add(std::move(task), ticks);
+    }
+
+    void submitAfter(std::chrono::milliseconds delay, TaskFn fn){
+        submitAfter(delay, makePooledTask<FnTask>(pool_, std::move(fn)));
+    }
+
+    //整批提交：一次策略锁往返，一次唤醒广播
+    void submitBatch(std::vector<std::unique_ptr<Task>> tasks){
+        std::size_t n = tasks.size();
+        if (n == 0) return;
+        stats_.onSubmit(n);
+        for (auto &t : tasks){
+            if (stats_.shouldSample()){
+                t = makePooledTask<TimedTask>(pool_, std::move(t), &stats_);
+            }
+        }
+        //和submit()同理：计数先行，worker才不会取到没计数的任务
+        queued_.fetch_add(n);
+        if (lockStrategy_){
+            std::lock_guard<std::mutex> lock(strategyMtx_);
+            strategy_->addTasks(std::move(tasks));
+        }else{
+            strategy_->addTasks(std::move(tasks));
+        }
+        {
+            std::lock_guard<std::mutex> lock(cvMtx_);
+        }
+        hasWork_.notify_all();
+    }
+
+    //刮一份当前统计：计数器 + 延迟直方图
+    SchedulerStats::Snapshot statsSnapshot() const {
+        return stats_.snapshot(queued_.load());
+    }
+
+    //等所有已提交任务执行完（队列空且没有在跑的）
+    void wait(){
+        std::unique_lock<std::mutex> lock(cvMtx_);
+        allDone_.wait(lock, [this]{
+            return queued_.load() == 0 && running_.load() == 0;
+        });
+    }
+
+    //排空队列后停掉工作线程，可重复调用
+    void shutdown(){
+        stopping_.store(true);
+        //先停定时线程，之后不会再有到期任务进队列
+        if (timerThread_.joinable()) timerThread_.join();
+        {
+            std::lock_guard<std::mutex> lock(cvMtx_);
+        }
+        hasWork_.notify_all();
+        for (auto &w : workers_){
+            if (w.joinable()) w.join();
+        }
+        workers_.clear();
+    }
+};
+
+//恢复动作就是一个8字节捕获的TaskFn，走池化的FnTask节点
+inline void ScheduleOnAwaiter::await_suspend(std::coroutine_handle<> h){
+    pool->submit(TaskFn([h]{ h.resume(); }));
+}
+
+//协程里co_await resumeOn(pool)：后续代码换到pool的工作线程上跑
+inline ScheduleOnAwaiter resumeOn(ThreadPoolScheduler &pool){
+    return {&pool};
+}
+
+template <typename T>
+void ResultState<T>::setValue(T v){
+    new (value_) T(std::move(v));
+    if (bits_.fetch_or(kHasValue, std::memory_order_acq_rel) & kHasCont){
+        sched_->submit(std::move(cont_));
+    }
+}
+
+template <typename T>
+void ResultState<T>::setContinuation(TaskFn fn){
+    cont_ = std::move(fn);
+    if (bits_.fetch_or(kHasCont, std::memory_order_acq_rel) & kHasValue){
+        sched_->submit(std::move(cont_));
+    }
+}
@@ -0,0 +1,229 @@
+/*
+    调度器基准测试
+        策略队列裸操作：addTask/getNextTask一对往返的开销
+        线程池端到端：P个生产者 x W个工作线程，tasks/sec和延迟分位数
+
+    参数化维度：
+        任务数、提交突发度（单个提交 vs 整批提交）、生产者/工作线程数
+
+    分配次数：
+        本文件重载了全局operator new来计数，
+        每个用例报告期间发生了多少次堆分配
+        （池化路径应该接近0，跑出大数字就是热路径退化了）
+
+    不依赖google-benchmark，自己计时，每个用例先热身一轮再计时
+
+    编译：g++ -std=c++20 -O2 -pthread TaskSchedulerBench.cpp
+*/
+
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+//全局分配计数：重载operator new，bench期间的delta就是分配次数
+static atomic<size_t> gAllocs{0};
+
+void *operator new(size_t n)
+{
+    gAllocs.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(n)) return p;
+    throw bad_alloc{};
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+//alignas(64)的结构（队列游标等）走带对齐的new
+//也搭在上面同一个计数的malloc上：多要一截，把返回地址对齐，
+//原始指针藏在对齐地址前面一格，释放时取出来还给free
+//（用posix_memalign配free虽然运行时没问题，但GCC 12的
+//-Wmismatched-new-delete会误报，这个文件的卖点就是可信的分配计数，
+//不能带着警告）
+void *operator new(size_t n, align_val_t a)
+{
+    gAllocs.fetch_add(1, memory_order_relaxed);
+    size_t align = static_cast<size_t>(a);
+    void *raw = malloc(n + align + sizeof(void*));
+    if (!raw) throw bad_alloc{};
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) +
+                         align - 1) & ~(align - 1);
+    *reinterpret_cast<void**>(aligned - sizeof(void*)) = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+//取回藏着的原始指针（地址运算走uintptr_t，
+//不然GCC把它当成对new出来的对象做[-1]下标，又是一个误报）
+static void freeAligned(void *p) noexcept
+{
+    if (!p) return;
+    free(*reinterpret_cast<void**>(
+        reinterpret_cast<uintptr_t>(p) - sizeof(void*)));
+}
+void operator delete(void *p, align_val_t) noexcept { freeAligned(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { freeAligned(p); }
+
+//什么都不做的任务：测的是队列本身，不是任务体
+class NopTask: public Task{
+public:
+    void execute() override {}
+};
+
+class CountTask: public Task{
+    atomic<size_t> &counter_;
+public:
+    explicit CountTask(atomic<size_t> &c): counter_(c) {}
+    void execute() override { counter_.fetch_add(1, memory_order_relaxed); }
+};
+
+//策略队列裸操作：按块push再pop，任务对象循环复用，
+//测出来的就是addTask/getNextTask本身
+void benchStrategyOps(const char *name, SchedulingStrategy &strategy, size_t n)
+{
+    constexpr size_t kBlock = 256;
+    vector<unique_ptr<Task>> block;
+    for (size_t i = 0; i < kBlock; ++i){
+        block.push_back(make_unique<NopTask>());
+    }
+
+    auto oneRound = [&]{
+        for (auto &t : block){
+            strategy.addTask(std::move(t));
+        }
+        for (auto &t : block){
+            t = strategy.getNextTask();
+        }
+    };
+
+    oneRound();   //热身
+
+    size_t rounds = n / kBlock;
+    size_t allocs0 = gAllocs.load();
+    auto t0 = Clock::now();
+    for (size_t r = 0; r < rounds; ++r){
+        oneRound();
+    }
+    auto t1 = Clock::now();
+    size_t allocs = gAllocs.load() - allocs0;
+
+    double ns = chrono::duration<double, nano>(t1 - t0).count();
+    cout << left << setw(24) << name
+         << fixed << setprecision(1)
+         << setw(8) << ns / (rounds * kBlock) << "ns/对(push+pop)  "
+         << "分配 " << allocs << endl;
+}
+
+//线程池端到端：producers个线程各提交perProducer个计数任务
+//burst=1走submit()，burst>1按burst一批走submitBatch()
+void benchPool(const char *name, unique_ptr<SchedulingStrategy> strategy,
+               size_t producers, size_t perProducer, size_t burst,
+               size_t threads)
+{
+    atomic<size_t> done{0};
+    ThreadPoolScheduler pool(std::move(strategy), threads);
+
+    size_t allocs0 = gAllocs.load();
+    auto t0 = Clock::now();
+    {
+        vector<thread> pts;
+        for (size_t p = 0; p < producers; ++p){
+            pts.emplace_back([&]{
+                if (burst <= 1){
+                    for (size_t i = 0; i < perProducer; ++i){
+                        pool.submit(pool.make_task<CountTask>(done));
+                    }
+                }else{
+                    for (size_t i = 0; i < perProducer; i += burst){
+                        size_t m = burst < perProducer - i ? burst
+                                                           : perProducer - i;
+                        vector<unique_ptr<Task>> batch;
+                        batch.reserve(m);
+                        for (size_t j = 0; j < m; ++j){
+                            batch.push_back(pool.make_task<CountTask>(done));
+                        }
+                        pool.submitBatch(std::move(batch));
+                    }
+                }
+            });
+        }
+        for (auto &t : pts) t.join();
+    }
+    pool.wait();
+    auto t1 = Clock::now();
+    size_t allocs = gAllocs.load() - allocs0;
+
+    double sec = chrono::duration<double>(t1 - t0).count();
+    double total = double(producers * perProducer);
+    auto stats = pool.statsSnapshot();
+    cout << left << setw(18) << name
+         << producers << "生产x" << threads << "工作  突发" << setw(4) << burst
+         << fixed << setprecision(1)
+         << setw(8) << total / sec / 1e6 << "M任务/秒  "
+         << "分配 " << setw(8) << allocs
+         << "wait_p50 " << stats.waitNs(0.5) << "ns  "
+         << "p99 " << stats.waitNs(0.99) << "ns" << endl;
+
+    if (done.load() != total){
+        cout << "  !! 任务丢失: " << done.load() << "/" << size_t(total) << endl;
+    }
+}
+
+int main()
+{
+    constexpr size_t kOpsN = 1000000;
+
+    cout << "==== 策略队列裸操作（单线程） ====" << endl;
+    {
+        FifoStrategy s;
+        benchStrategyOps("FifoStrategy", s, kOpsN);
+    }
+    {
+        PriorityStrategy s;
+        benchStrategyOps("PriorityStrategy", s, kOpsN);
+    }
+    {
+        DaryHeapStrategy s;
+        benchStrategyOps("DaryHeapStrategy", s, kOpsN);
+    }
+    {
+        MpmcFifoStrategy s(1024);
+        benchStrategyOps("MpmcFifoStrategy", s, kOpsN);
+    }
+    {
+        FairShareStrategy s(vector<uint32_t>{1});
+        benchStrategyOps("FairShareStrategy", s, kOpsN);
+    }
+
+    size_t hw = thread::hardware_concurrency();
+    if (hw == 0) hw = 4;
+    size_t workers = hw < 4 ? hw : 4;
+
+    cout << "\n==== 线程池端到端（任务对象全部池化） ====" << endl;
+    constexpr size_t kPerProducer = 100000;
+    for (size_t producers : {1u, 4u}){
+        for (size_t burst : {1u, 64u}){
+            benchPool("Fifo", make_unique<FifoStrategy>(),
+                      producers, kPerProducer, burst, workers);
+            benchPool("MpmcFifo", make_unique<MpmcFifoStrategy>(4096),
+                      producers, kPerProducer, burst, workers);
+            benchPool("WorkStealing", make_unique<WorkStealingStrategy>(workers),
+                      producers, kPerProducer, burst, workers);
+        }
+    }
+
+    cout << "\n==== 优先级策略端到端 ====" << endl;
+    benchPool("Priority", make_unique<PriorityStrategy>(),
+              1, kPerProducer, 1, workers);
+    benchPool("DaryHeap", make_unique<DaryHeapStrategy>(),
+              1, kPerProducer, 1, workers);
+    return 0;
+}
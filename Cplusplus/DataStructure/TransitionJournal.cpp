@@ -0,0 +1,336 @@
+/*
+    转换日志：事件溯源 + 成组提交
+
+    审计和崩溃恢复要求每次成功的转换都落盘
+    在SyncStateMachine_Callback的回调里直接fsync的话，
+    吞吐被磁盘同步速率封死（机械盘百来次/秒，NVMe也就几万）
+
+    这里的做法：
+        热路径只把(from, event, to)三元组写进一个内存环
+        （TraceRing同款的抢槽位写法，但换成Vyukov式的每槽序号，
+        记录不允许覆盖丢失——环满了生产者让步等待，形成背压）
+        后台提交线程成批收割环里的记录，一次write + 一次fsync
+        提交整批（group commit），刷盘间隔和批大小都可配
+        于是fsync的代价摊薄到几百上千条记录上，
+        热路径的开销就是一次fetch_add加几个字节的写
+
+    磁盘格式：定长4字节记录{from, event, to, 保留}顺序追加，
+    没有头没有指针，损坏尾部直接截断就能用
+
+    重放：启动时顺序读出事件流，逐条过转换表重建状态，
+    顺带校验记录里的from/to和表推出来的一致（审计）
+
+    编译：g++ -std=c++20 -O2 -pthread TransitionJournal.cpp
+*/
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+//磁盘上的一条记录：定长4字节
+struct JournalRecord{
+    uint8_t from;
+    uint8_t event;
+    uint8_t to;
+    uint8_t reserved;
+};
+
+class TransitionJournal{
+private:
+    //每槽带序号的环（和MPMC队列的槽位协议同源，消费端只有一个）：
+    //seq == i        槽位空闲，等第i次写入
+    //seq == i + 1    第i条记录就绪
+    //消费完置成i + 容量，留给下一圈
+    struct Slot{
+        std::atomic<uint64_t> seq;
+        JournalRecord rec;
+    };
+
+    std::vector<Slot> ring_;
+    uint64_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};   //生产者抢位
+    alignas(64) uint64_t tail_ = 0;               //只有提交线程动
+
+    int fd_ = -1;
+    chrono::milliseconds flushInterval_;
+    size_t maxBatch_;
+    std::thread committer_;
+    std::atomic<bool> stopping_{false};
+
+    //遥测：落盘条数和fsync次数，看摊薄效果
+    std::atomic<uint64_t> persisted_{0};
+    std::atomic<uint64_t> syncs_{0};
+    //写入/fsync出错的次数：日志号称可审计，吞掉错误等于假耐久
+    //调用方定期看一眼，非零就该告警
+    std::atomic<uint64_t> ioErrors_{0};
+
+    uint64_t fileSize_ = 0;   //上一次成功提交后的文件大小，只有提交线程动
+
+    //把整批写全：write可能被信号打断或只写一半（短写会把4字节记录
+    //劈在文件中间，replay的定长算术从那以后全错位），循环到写完为止
+    //真错误（ENOSPC等）返回false，由调用处统一处理
+    bool writeAll(const unsigned char *p, size_t len){
+        while (len > 0){
+            ssize_t n = ::write(fd_, p, len);
+            if (n < 0){
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void committerLoop(){
+        std::vector<JournalRecord> batch;
+        batch.reserve(maxBatch_);
+        auto lastFlush = chrono::steady_clock::now();
+
+        for (;;){
+            //收割：环里有多少拿多少，最多maxBatch条
+            while (batch.size() < maxBatch_){
+                Slot &s = ring_[tail_ & mask_];
+                if (s.seq.load(std::memory_order_acquire) != tail_ + 1) break;
+                batch.push_back(s.rec);
+                s.seq.store(tail_ + ring_.size(), std::memory_order_release);
+                ++tail_;
+            }
+            bool full = batch.size() >= maxBatch_;
+            bool stopping = stopping_.load();
+
+            //批满、到时间、或者在收尾，都触发一次成组提交
+            auto now = chrono::steady_clock::now();
+            if (!batch.empty() &&
+                (full || now - lastFlush >= flushInterval_ || stopping)){
+                size_t bytes = batch.size() * sizeof(JournalRecord);
+                if (writeAll(reinterpret_cast<const unsigned char *>(
+                                 batch.data()), bytes) &&
+                    ::fsync(fd_) == 0){
+                    fileSize_ += bytes;
+                    persisted_.fetch_add(batch.size(),
+                                         std::memory_order_relaxed);
+                    syncs_.fetch_add(1, std::memory_order_relaxed);
+                }else{
+                    //写或刷盘失败：砍掉可能劈了一半的尾巴，
+                    //文件保持在上一次成功提交的边界上，本批记录丢弃
+                    //（丢了多少看ioErrors_和persisted_的差）
+                    ioErrors_.fetch_add(1, std::memory_order_relaxed);
+                    ::ftruncate(fd_, static_cast<off_t>(fileSize_));
+                }
+                lastFlush = now;
+                batch.clear();
+            }
+
+            if (full) continue;   //生产压力大，马上接着收
+            if (stopping){
+                //收尾：环空且批也清了才退出，否则继续排空
+                if (batch.empty() &&
+                    ring_[tail_ & mask_].seq.load(std::memory_order_acquire) !=
+                        tail_ + 1){
+                    return;
+                }
+                continue;
+            }
+            //不满一批就小睡一会儿等凑批，不跟生产者抢CPU
+            //记录最多多等一个间隔加这一小觉
+            std::this_thread::sleep_for(chrono::microseconds(100));
+        }
+    }
+
+public:
+    //ringCapacity必须是2的幂
+    explicit TransitionJournal(const string &path,
+                               chrono::milliseconds flushInterval =
+                                   chrono::milliseconds(5),
+                               size_t maxBatch = 4096,
+                               size_t ringCapacity = 1 << 16)
+        : ring_(ringCapacity), mask_(ringCapacity - 1),
+          flushInterval_(flushInterval), maxBatch_(maxBatch)
+    {
+        for (uint64_t i = 0; i < ringCapacity; ++i){
+            ring_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+        if (fd_ < 0){
+            throw runtime_error("TransitionJournal: cannot open " + path);
+        }
+        committer_ = std::thread([this]{ committerLoop(); });
+    }
+
+    ~TransitionJournal(){ close(); }
+
+    TransitionJournal(const TransitionJournal &) = delete;
+    TransitionJournal &operator=(const TransitionJournal &) = delete;
+
+    //热路径：抢槽位，写三元组，翻序号
+    //环落后整整一圈时在这里让步等提交线程，记录不丢（背压）
+    void append(State from, Event event, State to){
+        uint64_t i = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot &s = ring_[i & mask_];
+        while (s.seq.load(std::memory_order_acquire) != i){
+            std::this_thread::yield();
+        }
+        s.rec = {static_cast<uint8_t>(from), static_cast<uint8_t>(event),
+                 static_cast<uint8_t>(to), 0};
+        s.seq.store(i + 1, std::memory_order_release);
+    }
+
+    //排空环、最后一次刷盘、停线程；可重复调用
+    void close(){
+        if (fd_ < 0) return;
+        stopping_.store(true);
+        if (committer_.joinable()) committer_.join();
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    uint64_t persistedCount() const { return persisted_.load(); }
+    uint64_t syncCount() const { return syncs_.load(); }
+    uint64_t ioErrorCount() const { return ioErrors_.load(); }
+
+    //重放：顺序读事件流，逐条过转换表重建状态
+    //记录里的from/to和表推出来的对不上算一次mismatch（审计告警）
+    struct ReplayResult{
+        State finalState = State::Idle;
+        size_t applied = 0;
+        size_t mismatches = 0;
+    };
+
+    static ReplayResult replay(const string &path){
+        ReplayResult r;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw runtime_error("TransitionJournal::replay: cannot open " + path);
+        }
+        State current = State::Idle;
+        JournalRecord buf[4096];
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof(buf))) > 0){
+            size_t count = static_cast<size_t>(n) / sizeof(JournalRecord);
+            for (size_t i = 0; i < count; ++i){
+                State next;
+                if (transitionRules.find(current,
+                                         static_cast<Event>(buf[i].event),
+                                         next) &&
+                    static_cast<uint8_t>(current) == buf[i].from &&
+                    static_cast<uint8_t>(next) == buf[i].to){
+                    current = next;
+                    ++r.applied;
+                }else{
+                    ++r.mismatches;
+                }
+            }
+        }
+        ::close(fd);
+        r.finalState = current;
+        return r;
+    }
+};
+
+int main()
+{
+    const string path = "/tmp/transitions.journal";
+
+    //正确性：回调挂上日志，跑一段事件，重放必须回到同一个状态
+    {
+        TransitionJournal journal(path);
+        SyncStateMachine_Callback machine;
+        machine.addCallback(TransitionDelegate(
+            [&journal](State f, Event e, State t){ journal.append(f, e, t); }));
+
+        machine.handleEvent(Event::Start);
+        machine.handleEvent(Event::Pause);
+        machine.handleEvent(Event::Pause);    //拒绝，不进日志
+        machine.handleEvent(Event::Resume);
+        machine.handleEvent(Event::Stop);
+        State live = machine.getCurrentState();
+        journal.close();
+
+        auto r = TransitionJournal::replay(path);
+        cout << "journal replay: applied=" << r.applied
+             << " mismatches=" << r.mismatches
+             << " final=" << strState[static_cast<int>(r.finalState)]
+             << (r.finalState == live ? " (matches live)" : " (MISMATCH!)")
+             << endl;
+    }
+
+    //吞吐：无日志的热路径 vs 挂日志，目标差距在10%以内
+    constexpr size_t kEvents = 2000000;
+    constexpr Event kCycle[] = {Event::Start, Event::Pause,
+                                Event::Resume, Event::Pause};
+    using Clock = chrono::steady_clock;
+
+    double baselineMops;
+    {
+        SyncStateMachine_Callback machine;
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < kEvents; ++i){
+            machine.handleEvent(kCycle[i % 4]);
+        }
+        auto t1 = Clock::now();
+        baselineMops = kEvents / chrono::duration<double>(t1 - t0).count() / 1e6;
+        cout << "\nno journal:   " << fixed << setprecision(1)
+             << baselineMops << " M事件/秒" << endl;
+    }
+
+    {
+        TransitionJournal journal(path);
+        SyncStateMachine_Callback machine;
+        machine.addCallback(TransitionDelegate(
+            [&journal](State f, Event e, State t){ journal.append(f, e, t); }));
+
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < kEvents; ++i){
+            machine.handleEvent(kCycle[i % 4]);
+        }
+        auto t1 = Clock::now();
+        journal.close();
+
+        double mops = kEvents / chrono::duration<double>(t1 - t0).count() / 1e6;
+        cout << "with journal: " << fixed << setprecision(1)
+             << mops << " M事件/秒  ("
+             << setprecision(1) << (1.0 - mops / baselineMops) * 100
+             << "% 开销)" << endl;
+        cout << "group commit: " << journal.persistedCount() << " 条记录 / "
+             << journal.syncCount() << " 次fsync (平均每次 "
+             << journal.persistedCount() / (journal.syncCount() ? journal.syncCount() : 1)
+             << " 条), io错误 " << journal.ioErrorCount() << endl;
+
+        auto r = TransitionJournal::replay(path);
+        cout << "replay check: applied=" << r.applied
+             << " mismatches=" << r.mismatches << endl;
+    }
+
+    //热路径本身的代价：裸测append()，这是事件线程真正多付的部分
+    //（上面的端到端差距还包含提交线程抢CPU的份额——
+    //单核机器上生产和落盘只能分时，有空闲核时那部分是重叠掉的）
+    {
+        TransitionJournal journal(path);
+        constexpr size_t kAppends = 1000000;
+        auto t0 = Clock::now();
+        for (size_t i = 0; i < kAppends; ++i){
+            journal.append(State::Running, Event::Pause, State::Paused);
+        }
+        auto t1 = Clock::now();
+        journal.close();
+        double ns = chrono::duration<double, nano>(t1 - t0).count() / kAppends;
+        cout << "append() alone: " << fixed << setprecision(1)
+             << ns << " ns/条" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*
+    转换表的二进制序列化 + mmap就地使用
+
+    transitionRules是写死在代码里的，编译期就构造好，这没问题；
+    但真实的表由产品配置生成，几万条规则、几十种机器类型，
+    每个进程启动时重新构造一遍既费时间又各占一份内存
+
+    文件格式（小端，偏移寻址，没有指针，映射进来直接用）：
+        TableFileHeader  魔数、版本、状态数、事件数
+        int8_t cells[stateCount * eventCount]   行优先，-1表示无此转换
+
+    这样：
+        启动是O(1)：open + mmap，不解析、不构造
+        同一台机器上N个进程共享同一份page cache，物理内存只有一份
+        查表和编译期的TransitionTable完全一样：一次下标运算
+
+    只依赖POSIX的mmap，Linux/mac都能跑
+
+    编译：g++ -std=c++20 -O2 TransitionTableFile.cpp
+*/
+
+#include "StateMachine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//文件头：固定16字节，后面紧跟格子数组
+struct TableFileHeader{
+    char magic[8];          //"FSMTBL\0\0"
+    uint32_t stateCount;
+    uint32_t eventCount;
+};
+
+constexpr char kMagic[8] = {'F', 'S', 'M', 'T', 'B', 'L', 0, 1};   //最后一字节是版本
+
+//把一张表写成二进制文件
+//任何带find(State, Event, State&)的表都能写，这里逐格探测
+void saveTable(const TransitionTable &table, const string &path)
+{
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out){
+        throw runtime_error("saveTable: cannot open " + path);
+    }
+
+    TableFileHeader header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.stateCount = kStateCount;
+    header.eventCount = kEventCount;
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (size_t s = 0; s < kStateCount; ++s){
+        for (size_t e = 0; e < kEventCount; ++e){
+            State to;
+            int8_t cell = table.find(static_cast<State>(s),
+                                     static_cast<Event>(e), to)
+                              ? static_cast<int8_t>(to)
+                              : int8_t(-1);
+            out.write(reinterpret_cast<const char *>(&cell), 1);
+        }
+    }
+    if (!out){
+        throw runtime_error("saveTable: write failed " + path);
+    }
+}
+
+//mmap加载的转换表：文件映射进来就地查，不拷贝、不构造
+//查表接口和TransitionTable一致，状态机代码不用关心表从哪来
+class MappedTransitionTable{
+private:
+    const TableFileHeader *header_ = nullptr;
+    const int8_t *cells_ = nullptr;   //紧跟在头后面
+    void *base_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    explicit MappedTransitionTable(const string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw runtime_error("MappedTransitionTable: cannot open " + path);
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0){
+            ::close(fd);
+            throw runtime_error("MappedTransitionTable: fstat failed " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        base_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   //映射建立后fd就不需要了
+        if (base_ == MAP_FAILED){
+            base_ = nullptr;
+            throw runtime_error("MappedTransitionTable: mmap failed " + path);
+        }
+
+        //校验头：魔数、版本、尺寸自洽
+        if (size_ < sizeof(TableFileHeader)){
+            throw runtime_error("MappedTransitionTable: file too small");
+        }
+        header_ = static_cast<const TableFileHeader *>(base_);
+        if (memcmp(header_->magic, kMagic, sizeof(kMagic)) != 0){
+            throw runtime_error("MappedTransitionTable: bad magic/version");
+        }
+        size_t need = sizeof(TableFileHeader) +
+                      size_t(header_->stateCount) * header_->eventCount;
+        if (size_ < need){
+            throw runtime_error("MappedTransitionTable: truncated file");
+        }
+        cells_ = reinterpret_cast<const int8_t *>(header_ + 1);
+    }
+
+    ~MappedTransitionTable()
+    {
+        if (base_) munmap(base_, size_);
+    }
+
+    MappedTransitionTable(const MappedTransitionTable &) = delete;
+    MappedTransitionTable &operator=(const MappedTransitionTable &) = delete;
+
+    size_t stateCount() const { return header_->stateCount; }
+    size_t eventCount() const { return header_->eventCount; }
+
+    //和TransitionTable::find同样的语义：一次下标运算
+    bool find(State from, Event event, State &to) const
+    {
+        int8_t cell = cells_[static_cast<size_t>(from) * header_->eventCount +
+                             static_cast<size_t>(event)];
+        if (cell < 0) return false;
+        to = static_cast<State>(cell);
+        return true;
+    }
+};
+
+//用映射表驱动的状态机：和LockFreeStateMachine一样的CAS循环，
+//只是表来自构造参数而不是全局常量
+class MappedStateMachine{
+private:
+    const MappedTransitionTable &table_;
+    std::atomic<State> currentState{State::Idle};
+
+public:
+    explicit MappedStateMachine(const MappedTransitionTable &table)
+        : table_(table) {}
+
+    bool handleEvent(Event event)
+    {
+        State expected = currentState.load();
+        State desired;
+        do{
+            if (!table_.find(expected, event, desired)) return false;
+        }while(!currentState.compare_exchange_weak(expected, desired));
+        return true;
+    }
+
+    State getCurrentState() const { return currentState.load(); }
+};
+
+int main()
+{
+    const string path = "/tmp/transition_rules.fsm";
+
+    //1. 把编译期的表序列化出去（生产环境里这一步是配置生成工具做的）
+    saveTable(transitionRules, path);
+    cout << "saved " << path << " ("
+         << sizeof(TableFileHeader) + kStateCount * kEventCount
+         << " bytes)" << endl;
+
+    //2. mmap加载：计时，应该是微秒级，和表大小无关
+    auto t0 = chrono::steady_clock::now();
+    MappedTransitionTable mapped(path);
+    auto t1 = chrono::steady_clock::now();
+    cout << "mapped in "
+         << chrono::duration<double, micro>(t1 - t0).count() << "us, "
+         << mapped.stateCount() << " states x "
+         << mapped.eventCount() << " events" << endl;
+
+    //3. 逐格和编译期的表对过：映射表必须完全等价
+    bool identical = true;
+    for (size_t s = 0; s < kStateCount; ++s){
+        for (size_t e = 0; e < kEventCount; ++e){
+            State a, b;
+            bool fa = transitionRules.find(static_cast<State>(s),
+                                           static_cast<Event>(e), a);
+            bool fb = mapped.find(static_cast<State>(s),
+                                  static_cast<Event>(e), b);
+            if (fa != fb || (fa && a != b)) identical = false;
+        }
+    }
+    cout << "equivalence check: " << (identical ? "ok" : "MISMATCH!") << endl;
+
+    //4. 直接在映射上跑一台机器
+    MappedStateMachine machine(mapped);
+    machine.handleEvent(Event::Start);
+    machine.handleEvent(Event::Pause);
+    machine.handleEvent(Event::Resume);
+    machine.handleEvent(Event::Stop);
+    cout << "machine on mapped table: "
+         << strState[static_cast<int>(machine.getCurrentState())] << endl;
+    return 0;
+}